@@ -0,0 +1,342 @@
+#include <math/mat.h>
+#include <math/quat.h>
+#include <math/batch.h>
+#include <math/frustum.h>
+#include <object/render_obj.h>
+#include <utils/timer.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// microbenchmarks for the math layer. No GL context is created, so this runs anywhere
+// usage: sgl_math_bench [--csv | --json] [filter]
+//   --csv/--json  machine readable output instead of a table
+//   filter        only run benchmarks whose name contains filter
+
+namespace
+{
+	constexpr std::size_t count = 1 << 16;
+	constexpr double min_seconds = 0.25;
+
+	struct result
+	{
+		std::string name;
+		double ns_per_op;
+		double ops_per_second;
+		std::size_t ops;
+	};
+
+	// results are folded into this so the compiler can't discard the work
+	volatile float sink;
+
+	template <typename T>
+	void consume(const T &v)
+	{
+		float f;
+		std::memcpy(&f, &v, sizeof(float));
+		sink = sink + f;
+	}
+
+	// calls fn (which performs ops_per_call operations) until min_seconds have passed
+	template <typename Fn>
+	result run(const char *name, std::size_t ops_per_call, Fn &&fn)
+	{
+		// warm up caches and branch predictors
+		fn();
+
+		sgl::timer t;
+		std::size_t calls = 0;
+		t.start();
+		do
+		{
+			fn();
+			++calls;
+		} while (t.lap() < min_seconds);
+		t.stop();
+
+		std::size_t ops = calls * ops_per_call;
+		return {name, t.seconds() * 1e9 / ops, ops / t.seconds(), ops};
+	}
+
+	// transformable_obj with nothing to draw, to time update_model
+	class bench_obj : public sgl::transformable_obj<true, true, true>
+	{
+	public:
+		void draw(sgl::render_target &, const sgl::render_settings &) const override {}
+
+		inline void touch() { data_changed(); }
+	};
+
+	std::mt19937 rng(42);
+
+	float rand_float(float min = -1, float max = 1)
+	{
+		return std::uniform_real_distribution<float>(min, max)(rng);
+	}
+
+	template <sgl::vec_len dim>
+	std::vector<sgl::vec<float, dim>> rand_vecs()
+	{
+		std::vector<sgl::vec<float, dim>> res(count);
+		for (auto &v : res)
+			for (sgl::vec_len i = 0; i < dim; ++i)
+				v[i] = rand_float();
+		return res;
+	}
+
+	std::vector<sgl::mat4> rand_transforms()
+	{
+		std::vector<sgl::mat4> res(count);
+		for (auto &m : res)
+			m = sgl::trs(sgl::vec3{rand_float(), rand_float(), rand_float()},
+						 sgl::rot3x3(rand_float(-3, 3), sgl::vec3{rand_float(), rand_float(), 1}),
+						 sgl::vec3{rand_float(.5f, 2), rand_float(.5f, 2), rand_float(.5f, 2)});
+		return res;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	enum class format { table, csv, json } fmt = format::table;
+	const char *filter = nullptr;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!std::strcmp(argv[i], "--csv"))
+			fmt = format::csv;
+		else if (!std::strcmp(argv[i], "--json"))
+			fmt = format::json;
+		else
+			filter = argv[i];
+	}
+
+	auto v3a = rand_vecs<3>();
+	auto v3b = rand_vecs<3>();
+	auto v4a = rand_vecs<4>();
+	auto mats = rand_transforms();
+	auto mats_b = rand_transforms();
+	std::vector<float> scalars(count);
+	for (auto &s : scalars)
+		s = rand_float(.1f, 3);
+
+	std::vector<result> results;
+	auto bench = [&](const char *name, std::size_t ops, auto &&fn)
+	{
+		if (filter && !std::strstr(name, filter))
+			return;
+		results.push_back(run(name, ops, fn));
+	};
+
+	bench("vec3_add", count, [&]
+	{
+		sgl::vec3 acc{};
+		for (std::size_t i = 0; i < count; ++i)
+			acc += v3a[i] + v3b[i];
+		consume(acc);
+	});
+
+	bench("vec3_dot", count, [&]
+	{
+		float acc = 0;
+		for (std::size_t i = 0; i < count; ++i)
+			acc += sgl::dot(v3a[i], v3b[i]);
+		consume(acc);
+	});
+
+	bench("vec3_cross", count, [&]
+	{
+		sgl::vec3 acc{};
+		for (std::size_t i = 0; i < count; ++i)
+			acc += sgl::cross(v3a[i], v3b[i]);
+		consume(acc);
+	});
+
+	bench("vec3_normalize", count, [&]
+	{
+		sgl::vec3 acc{};
+		for (std::size_t i = 0; i < count; ++i)
+			acc += sgl::normalize(v3a[i]);
+		consume(acc);
+	});
+
+	bench("mat4_mul_vec4", count, [&]
+	{
+		sgl::vec4 acc{};
+		for (std::size_t i = 0; i < count; ++i)
+			acc += mats[i] * v4a[i];
+		consume(acc);
+	});
+
+	bench("mat4_mul_mat4", count, [&]
+	{
+		sgl::mat4 acc = sgl::identity();
+		for (std::size_t i = 0; i < count; ++i)
+			acc[0] += (mats[i] * mats_b[i])[0];
+		consume(acc);
+	});
+
+	bench("mat4_transpose", count, [&]
+	{
+		sgl::vec4 acc{};
+		for (std::size_t i = 0; i < count; ++i)
+			acc += sgl::transpose(mats[i])[1];
+		consume(acc);
+	});
+
+	bench("mat4_inverse", count, [&]
+	{
+		sgl::vec4 acc{};
+		for (std::size_t i = 0; i < count; ++i)
+			acc += sgl::inverse(mats[i])[3];
+		consume(acc);
+	});
+
+	bench("mat4_affine_inverse", count, [&]
+	{
+		sgl::vec4 acc{};
+		for (std::size_t i = 0; i < count; ++i)
+			acc += sgl::affine_inverse(mats[i])[3];
+		consume(acc);
+	});
+
+	bench("perspective", count, [&]
+	{
+		sgl::vec4 acc{};
+		for (std::size_t i = 0; i < count; ++i)
+			acc += sgl::perspective(scalars[i], 1.5f, .1f, 100.f)[2];
+		consume(acc);
+	});
+
+	bench("rot", count, [&]
+	{
+		sgl::vec4 acc{};
+		for (std::size_t i = 0; i < count; ++i)
+			acc += sgl::rot(scalars[i], v3a[i])[1];
+		consume(acc);
+	});
+
+	bench("translate", count, [&]
+	{
+		sgl::vec4 acc{};
+		for (std::size_t i = 0; i < count; ++i)
+			acc += sgl::translate(v3a[i])[3];
+		consume(acc);
+	});
+
+	bench("quat_to_mat", count, [&]
+	{
+		sgl::vec3 acc{};
+		for (std::size_t i = 0; i < count; ++i)
+			acc += sgl::rot3x3(sgl::quat{v4a[i].x, v4a[i].y, v4a[i].z, v4a[i].w})[0];
+		consume(acc);
+	});
+
+	bench("quat_slerp", count, [&]
+	{
+		sgl::quat a = sgl::angle_axis(.3f, sgl::vec3{0, 1, 0});
+		sgl::quat b = sgl::angle_axis(2.f, sgl::vec3{1, 0, 0});
+		float acc = 0;
+		for (std::size_t i = 0; i < count; ++i)
+			acc += sgl::slerp(a, b, scalars[i] / 3).w;
+		consume(acc);
+	});
+
+	{
+		// the points are transformed in place every call, so the matrix must not scale them, or they overflow to inf and NaN and the
+		// timings measure slow denormal/NaN arithmetic instead
+		const sgl::mat4 spin = sgl::y_rot(.5f);
+
+		auto pts = v3a;
+		bench("transform_pts_iter", count, [&]
+		{
+			sgl::transform_pts(pts.begin(), pts.end(), spin);
+			consume(pts[0]);
+		});
+
+		bench("transform_pts_span_seq", count, [&]
+		{
+			sgl::transform_pts(std::execution::seq, pts, spin);
+			consume(pts[0]);
+		});
+
+		bench("transform_pts_span_par", count, [&]
+		{
+			sgl::transform_pts(std::execution::par_unseq, pts, spin);
+			consume(pts[0]);
+		});
+
+		sgl::soa_buffer<3> soa{v3a};
+		bench("transform_pts_soa_seq", count, [&]
+		{
+			sgl::transform_pts(std::execution::seq, soa.view(), spin);
+			consume(*soa.axis(0));
+		});
+
+		bench("transform_pts_soa_par", count, [&]
+		{
+			sgl::transform_pts(std::execution::par_unseq, soa.view(), spin);
+			consume(*soa.axis(0));
+		});
+	}
+
+	{
+		sgl::frustum f(sgl::perspective(1.f, 1.5f, .1f, 100.f) * mats[0]);
+		std::vector<sgl::bound> boxes(count);
+		for (std::size_t i = 0; i < count; ++i)
+			boxes[i] = {v3a[i] * 50.f, {1, 1, 1}};
+		std::unique_ptr<bool[]> visible(new bool[count]);
+
+		bench("frustum_aabb", count, [&]
+		{
+			consume(static_cast<float>(f.intersects(boxes, std::span<bool>(visible.get(), count))));
+		});
+	}
+
+	{
+		std::vector<bench_obj> objs(count / 4);
+		for (std::size_t i = 0; i < objs.size(); ++i)
+		{
+			objs[i].set_loc(v3a[i]);
+			objs[i].set_scale(v3b[i]);
+			objs[i].set_rot_axis(v3a[i] + v3b[i]);
+			objs[i].set_angle(scalars[i]);
+		}
+
+		bench("update_model", objs.size(), [&]
+		{
+			for (auto &obj : objs)
+			{
+				obj.touch();
+				obj.update_model();
+			}
+			consume(objs[0].get_model());
+		});
+	}
+
+	switch (fmt)
+	{
+	case format::table:
+		std::printf("%-26s %12s %14s\n", "benchmark", "ns/op", "Mops/s");
+		for (const auto &r : results)
+			std::printf("%-26s %12.3f %14.2f\n", r.name.c_str(), r.ns_per_op, r.ops_per_second / 1e6);
+		break;
+	case format::csv:
+		std::printf("name,ns_per_op,ops_per_second,ops\n");
+		for (const auto &r : results)
+			std::printf("%s,%.4f,%.1f,%zu\n", r.name.c_str(), r.ns_per_op, r.ops_per_second, r.ops);
+		break;
+	case format::json:
+		std::printf("[\n");
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			const auto &r = results[i];
+			std::printf("  {\"name\": \"%s\", \"ns_per_op\": %.4f, \"ops_per_second\": %.1f, \"ops\": %zu}%s\n",
+						r.name.c_str(), r.ns_per_op, r.ops_per_second, r.ops, i + 1 < results.size() ? "," : "");
+		}
+		std::printf("]\n");
+		break;
+	}
+}
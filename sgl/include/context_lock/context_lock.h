@@ -1,6 +1,7 @@
 #pragma once
 #include "macro.h"
 #include <GL/glew.h>
+#include "gl_state.h"
 
 SGL_BEG
 
@@ -9,18 +10,15 @@ DETAIL_BEG
 template <int pname>
 class context_lock;
 
+// locks save a binding or capability when constructed and restore it when destroyed.
+// Values are read from and restored through the state cache, so nested locks on unchanged state don't reach the driver
+
 template <>
 class context_lock<GL_CURRENT_PROGRAM>
 {
 public:
-	context_lock() : prev{}
-	{
-		glGetIntegerv(GL_CURRENT_PROGRAM, (int*)&prev);
-	}
-	~context_lock()
-	{
-		glUseProgram(prev);
-	}
+	context_lock() : prev{state().program()} {}
+	~context_lock() { state().use_program(prev); }
 private:
 	GLuint prev;
 };
@@ -29,14 +27,8 @@ template <>
 class context_lock<GL_VERTEX_ARRAY_BINDING>
 {
 public:
-	context_lock() : prev{}
-	{
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, (int*)&prev);
-	}
-	~context_lock()
-	{
-		glBindVertexArray(prev);
-	}
+	context_lock() : prev{state().vertex_array()} {}
+	~context_lock() { state().bind_vertex_array(prev); }
 private:
 	GLuint prev;
 };
@@ -45,14 +37,8 @@ template <>
 class context_lock<GL_TEXTURE_BINDING_2D>
 {
 public:
-	context_lock() : prev{}
-	{
-		glGetIntegerv(GL_TEXTURE_BINDING_2D, (int*)&prev);
-	}
-	~context_lock()
-	{
-		glBindTexture(GL_TEXTURE_2D, prev);
-	}
+	context_lock() : prev{state().texture_2d()} {}
+	~context_lock() { state().bind_texture_2d(prev); }
 private:
 	GLuint prev;
 };
@@ -61,14 +47,8 @@ template <>
 class context_lock<GL_ARRAY_BUFFER_BINDING>
 {
 public:
-	context_lock() : prev{}
-	{
-		glGetIntegerv(GL_ARRAY_BUFFER_BINDING, (int*)&prev);
-	}
-	~context_lock()
-	{
-		glBindBuffer(GL_ARRAY_BUFFER, prev);
-	}
+	context_lock() : prev{state().buffer(GL_ARRAY_BUFFER)} {}
+	~context_lock() { state().bind_buffer(GL_ARRAY_BUFFER, prev); }
 private:
 	GLuint prev;
 };
@@ -80,14 +60,18 @@ template <>
 class context_lock<GL_ELEMENT_ARRAY_BUFFER_BINDING>
 {
 public:
-	context_lock() : prev{}
-	{
-		glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, (int*)&prev);
-	}
-	~context_lock()
-	{
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, prev);
-	}
+	context_lock() : prev{state().buffer(GL_ELEMENT_ARRAY_BUFFER)} {}
+	~context_lock() { state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, prev); }
+private:
+	GLuint prev;
+};
+
+template <>
+class context_lock<GL_UNIFORM_BUFFER_BINDING>
+{
+public:
+	context_lock() : prev{state().buffer(GL_UNIFORM_BUFFER)} {}
+	~context_lock() { state().bind_buffer(GL_UNIFORM_BUFFER, prev); }
 private:
 	GLuint prev;
 };
@@ -96,14 +80,8 @@ template <>
 class context_lock<GL_FRAMEBUFFER_BINDING>
 {
 public:
-	context_lock() : prev{}
-	{
-		glGetIntegerv(GL_FRAMEBUFFER_BINDING, (int*)&prev);
-	}
-	~context_lock()
-	{
-		glBindFramebuffer(GL_FRAMEBUFFER, prev);
-	}
+	context_lock() : prev{state().framebuffer()} {}
+	~context_lock() { state().bind_framebuffer(prev); }
 private:
 	GLuint prev;
 };
@@ -112,14 +90,8 @@ template <>
 class context_lock<GL_RENDERBUFFER_BINDING>
 {
 public:
-	context_lock() : prev{}
-	{
-		glGetIntegerv(GL_RENDERBUFFER_BINDING, (int*)&prev);
-	}
-	~context_lock()
-	{
-		glBindRenderbuffer(GL_RENDERBUFFER, prev);
-	}
+	context_lock() : prev{state().renderbuffer()} {}
+	~context_lock() { state().bind_renderbuffer(prev); }
 private:
 	GLuint prev;
 };
@@ -128,49 +100,28 @@ template <>
 class context_lock<GL_BLEND>
 {
 public:
-	context_lock() : prev{}
-	{
-		glGetBooleanv(GL_BLEND, &prev);
-	}
-	~context_lock()
-	{
-		if (prev)
-			glEnable(GL_BLEND);
-		else
-			glDisable(GL_BLEND);
-	}
+	context_lock() : prev{state().enabled(GL_BLEND)} {}
+	~context_lock() { state().set_enabled(GL_BLEND, prev); }
 private:
-	GLboolean prev;
+	bool prev;
 };
 
 template <>
 class context_lock<GL_VIEWPORT>
 {
 public:
-	context_lock() : prev{}
-	{
-		glGetIntegerv(GL_VIEWPORT, prev);
-	}
-	~context_lock()
-	{
-		glViewport(prev[0], prev[1], prev[2], prev[3]);
-	}
+	context_lock() : prev{state().viewport()} {}
+	~context_lock() { state().set_viewport(prev); }
 private:
-	int prev[4];
+	gl_state::viewport_value prev;
 };
 
 template <>
 class context_lock<GL_LINE_WIDTH>
 {
 public:
-	context_lock() : prev{}
-	{
-		glGetFloatv(GL_LINE_WIDTH, &prev);
-	}
-	~context_lock()
-	{
-		glLineWidth(prev);
-	}
+	context_lock() : prev{state().line_width()} {}
+	~context_lock() { state().set_line_width(prev); }
 private:
 	float prev;
 };
@@ -179,36 +130,51 @@ template <>
 class context_lock<GL_CULL_FACE>
 {
 public:
-	context_lock() : prev_state{}, prev_mode{}
-	{
-		glGetBooleanv(GL_CULL_FACE, &prev_state);
-		glGetIntegerv(GL_CULL_FACE_MODE, &prev_mode);
-	}
+	context_lock() : prev_state{state().enabled(GL_CULL_FACE)}, prev_mode{state().cull_face_mode()} {}
 	~context_lock()
 	{
-		glCullFace(prev_mode);
-		if (prev_state)
-			glEnable(GL_CULL_FACE);
-		else
-			glDisable(GL_CULL_FACE);
+		state().set_cull_face_mode(prev_mode);
+		state().set_enabled(GL_CULL_FACE, prev_state);
 	}
 private:
-	GLboolean prev_state;
-	int prev_mode;
+	bool prev_state;
+	GLenum prev_mode;
+};
+
+template <>
+class context_lock<GL_UNPACK_ALIGNMENT>
+{
+public:
+	context_lock() : prev{state().unpack_alignment()} {}
+	~context_lock() { state().set_unpack_alignment(prev); }
+private:
+	GLint prev;
 };
 
+template <>
+class context_lock<GL_PACK_ALIGNMENT>
+{
+public:
+	context_lock() : prev{state().pack_alignment()} {}
+	~context_lock() { state().set_pack_alignment(prev); }
+private:
+	GLint prev;
+};
 
 using shader_lock = context_lock<GL_CURRENT_PROGRAM>;
 using texture_lock = context_lock<GL_TEXTURE_BINDING_2D>;
 using vao_lock = context_lock<GL_VERTEX_ARRAY_BINDING>;
 using vbo_lock = context_lock<GL_ARRAY_BUFFER_BINDING>;
 using ebo_lock = context_lock<GL_ELEMENT_ARRAY_BUFFER_BINDING>;
+using ubo_lock = context_lock<GL_UNIFORM_BUFFER_BINDING>;
 using fbo_lock = context_lock<GL_FRAMEBUFFER_BINDING>;
 using rbo_lock = context_lock<GL_RENDERBUFFER_BINDING>;
 using blend_lock = context_lock<GL_BLEND>;
 using viewport_lock = context_lock<GL_VIEWPORT>;
 using line_width_lock = context_lock<GL_LINE_WIDTH>;
 using cull_face_lock = context_lock<GL_CULL_FACE>;
+using unpack_alignment_lock = context_lock<GL_UNPACK_ALIGNMENT>;
+using pack_alignment_lock = context_lock<GL_PACK_ALIGNMENT>;
 
 //inline constexpr int DRAW_LOCK = 0;
 //template <>
@@ -243,6 +209,9 @@ inline constexpr GLenum binding<GL_ARRAY_BUFFER> = GL_ARRAY_BUFFER_BINDING;
 template <>
 inline constexpr GLenum binding<GL_ELEMENT_ARRAY_BUFFER> = GL_ELEMENT_ARRAY_BUFFER_BINDING;
 
+template <>
+inline constexpr GLenum binding<GL_UNIFORM_BUFFER> = GL_UNIFORM_BUFFER_BINDING;
+
 template <>
 inline constexpr GLenum binding<GL_FRAMEBUFFER> = GL_FRAMEBUFFER_BINDING;
 
@@ -0,0 +1,381 @@
+#pragma once
+#include "macro.h"
+#include <GL/glew.h>
+
+#include <type_traits>
+
+// define SGL_CHECK_GL_STATE (cmake option of the same name) to compare every cached value against glGet when it is read
+#ifdef SGL_CHECK_GL_STATE
+#include "utils/error.h"
+#include <string>
+#endif
+
+SGL_BEG
+
+DETAIL_BEG
+
+/// @brief cpu side copy of the GL bindings and capabilities sgl uses, so reading them doesn't need a glGet round trip
+/// and binding what is already bound is skipped. Values are queried from GL the first time they are read.
+/// Only one context is tracked, call invalidate after making another context current or after changing state with raw GL calls
+class gl_state
+{
+public:
+	static constexpr unsigned int texture_units = 32;
+	static constexpr unsigned int uniform_buffer_bindings = 16;
+
+	inline gl_state() { invalidate(); }
+
+	/// @brief forget every cached value, they will be queried from GL again when needed
+	inline void invalidate()
+	{
+		m_program.known = m_vertex_array.known = m_array_buffer.known = m_element_buffer.known = m_uniform_buffer.known = false;
+		m_framebuffer.known = m_renderbuffer.known = m_active_texture.known = false;
+		for (auto &t : m_textures)
+			t.known = false;
+		for (auto &b : m_uniform_buffer_bases)
+			b.known = false;
+		m_blend.known = m_cull_face.known = m_cull_face_mode.known = m_line_width.known = m_viewport.known = false;
+		m_unpack_alignment.known = m_pack_alignment.known = false;
+	}
+
+	inline GLuint program() { return get(m_program, GL_CURRENT_PROGRAM, "program"); }
+	inline void use_program(GLuint id)
+	{
+		if (set(m_program, id, GL_CURRENT_PROGRAM, "program"))
+			glUseProgram(id);
+	}
+
+	inline GLuint vertex_array() { return get(m_vertex_array, GL_VERTEX_ARRAY_BINDING, "vertex array"); }
+	inline void bind_vertex_array(GLuint id)
+	{
+		if (set(m_vertex_array, id, GL_VERTEX_ARRAY_BINDING, "vertex array"))
+		{
+			glBindVertexArray(id);
+			// the element buffer binding is part of the vertex array
+			m_element_buffer.known = false;
+		}
+	}
+
+	inline GLuint buffer(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_ARRAY_BUFFER:
+			return get(m_array_buffer, GL_ARRAY_BUFFER_BINDING, "array buffer");
+		case GL_ELEMENT_ARRAY_BUFFER:
+			return get(m_element_buffer, GL_ELEMENT_ARRAY_BUFFER_BINDING, "element buffer");
+		case GL_UNIFORM_BUFFER:
+			return get(m_uniform_buffer, GL_UNIFORM_BUFFER_BINDING, "uniform buffer");
+		}
+		GLint res;
+		glGetIntegerv(binding_of(target), &res);
+		return static_cast<GLuint>(res);
+	}
+	inline void bind_buffer(GLenum target, GLuint id)
+	{
+		if (cached_value<GLuint> *slot = buffer_slot(target))
+		{
+			if (!set(*slot, id, binding_of(target), "buffer"))
+				return;
+		}
+		glBindBuffer(target, id);
+	}
+
+	// bind to an indexed binding point of GL_UNIFORM_BUFFER, which also sets the generic binding
+	inline void bind_uniform_buffer_base(GLuint index, GLuint id)
+	{
+		if (index < uniform_buffer_bindings)
+		{
+			if (!set_base(index, id))
+				return;
+		}
+		glBindBufferBase(GL_UNIFORM_BUFFER, index, id);
+		m_uniform_buffer.value = id;
+		m_uniform_buffer.known = true;
+	}
+
+	inline GLuint framebuffer() { return get(m_framebuffer, GL_FRAMEBUFFER_BINDING, "framebuffer"); }
+	inline void bind_framebuffer(GLuint id)
+	{
+		if (set(m_framebuffer, id, GL_FRAMEBUFFER_BINDING, "framebuffer"))
+			glBindFramebuffer(GL_FRAMEBUFFER, id);
+	}
+
+	inline GLuint renderbuffer() { return get(m_renderbuffer, GL_RENDERBUFFER_BINDING, "renderbuffer"); }
+	inline void bind_renderbuffer(GLuint id)
+	{
+		if (set(m_renderbuffer, id, GL_RENDERBUFFER_BINDING, "renderbuffer"))
+			glBindRenderbuffer(GL_RENDERBUFFER, id);
+	}
+
+	// texture unit, starting from 0
+	inline unsigned int active_texture() { return get(m_active_texture, GL_ACTIVE_TEXTURE, "active texture") - GL_TEXTURE0; }
+	inline void set_active_texture(unsigned int unit)
+	{
+		if (set(m_active_texture, static_cast<GLuint>(GL_TEXTURE0 + unit), GL_ACTIVE_TEXTURE, "active texture"))
+			glActiveTexture(GL_TEXTURE0 + unit);
+	}
+
+	// GL_TEXTURE_2D binding of the active texture unit
+	inline GLuint texture_2d()
+	{
+		unsigned int unit = active_texture();
+		if (unit >= texture_units)
+			return query<GLuint>(GL_TEXTURE_BINDING_2D);
+		return get(m_textures[unit], GL_TEXTURE_BINDING_2D, "2d texture");
+	}
+	inline void bind_texture_2d(GLuint id)
+	{
+		unsigned int unit = active_texture();
+		if (unit >= texture_units || set(m_textures[unit], id, GL_TEXTURE_BINDING_2D, "2d texture"))
+			glBindTexture(GL_TEXTURE_2D, id);
+	}
+
+	// GL_BLEND or GL_CULL_FACE
+	inline bool enabled(GLenum cap) { return get(cap == GL_BLEND ? m_blend : m_cull_face, cap, "capability"); }
+	inline void set_enabled(GLenum cap, bool enable)
+	{
+		if (set(cap == GL_BLEND ? m_blend : m_cull_face, enable, cap, "capability"))
+		{
+			if (enable)
+				glEnable(cap);
+			else
+				glDisable(cap);
+		}
+	}
+
+	inline GLenum cull_face_mode() { return get(m_cull_face_mode, GL_CULL_FACE_MODE, "cull face mode"); }
+	inline void set_cull_face_mode(GLenum mode)
+	{
+		if (set(m_cull_face_mode, mode, GL_CULL_FACE_MODE, "cull face mode"))
+			glCullFace(mode);
+	}
+
+	inline float line_width() { return get(m_line_width, GL_LINE_WIDTH, "line width"); }
+	inline void set_line_width(float width)
+	{
+		if (set(m_line_width, width, GL_LINE_WIDTH, "line width"))
+			glLineWidth(width);
+	}
+
+	// row alignment of pixel transfers, set through unpack_alignment_lock and pack_alignment_lock so it is restored afterwards
+	inline GLint unpack_alignment() { return get(m_unpack_alignment, GL_UNPACK_ALIGNMENT, "unpack alignment"); }
+	inline void set_unpack_alignment(GLint alignment)
+	{
+		if (set(m_unpack_alignment, alignment, GL_UNPACK_ALIGNMENT, "unpack alignment"))
+			glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+	}
+
+	inline GLint pack_alignment() { return get(m_pack_alignment, GL_PACK_ALIGNMENT, "pack alignment"); }
+	inline void set_pack_alignment(GLint alignment)
+	{
+		if (set(m_pack_alignment, alignment, GL_PACK_ALIGNMENT, "pack alignment"))
+			glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+	}
+
+	struct viewport_value
+	{
+		GLint x, y, width, height;
+
+		inline bool operator==(const viewport_value &o) const { return x == o.x && y == o.y && width == o.width && height == o.height; }
+		inline bool operator!=(const viewport_value &o) const { return !(*this == o); }
+	};
+
+	inline viewport_value viewport() { return get(m_viewport, GL_VIEWPORT, "viewport"); }
+	inline void set_viewport(viewport_value v)
+	{
+		if (set(m_viewport, v, GL_VIEWPORT, "viewport"))
+			glViewport(v.x, v.y, v.width, v.height);
+	}
+
+	// deleting a bound object resets its binding to 0, call these before deleting
+	inline void on_delete_vertex_array(GLuint id)
+	{
+		if (m_vertex_array.known && m_vertex_array.value == id)
+		{
+			m_vertex_array.value = 0;
+			m_element_buffer.known = false;
+		}
+	}
+	inline void on_delete_buffer(GLuint id)
+	{
+		forget(m_array_buffer, id);
+		forget(m_element_buffer, id);
+		forget(m_uniform_buffer, id);
+		for (auto &b : m_uniform_buffer_bases)
+			forget(b, id);
+	}
+	inline void on_delete_texture(GLuint id)
+	{
+		for (auto &t : m_textures)
+			forget(t, id);
+	}
+	inline void on_delete_framebuffer(GLuint id) { forget(m_framebuffer, id); }
+	inline void on_delete_renderbuffer(GLuint id) { forget(m_renderbuffer, id); }
+
+private:
+	template <typename T>
+	struct cached_value
+	{
+		T value;
+		bool known;
+	};
+
+	cached_value<GLuint> m_program;
+	cached_value<GLuint> m_vertex_array;
+	cached_value<GLuint> m_array_buffer;
+	cached_value<GLuint> m_element_buffer;
+	cached_value<GLuint> m_uniform_buffer;
+	// only written through bind_uniform_buffer_base, and only read back from GL to check it
+	cached_value<GLuint> m_uniform_buffer_bases[uniform_buffer_bindings];
+	cached_value<GLuint> m_framebuffer;
+	cached_value<GLuint> m_renderbuffer;
+	cached_value<GLuint> m_active_texture;
+	cached_value<GLuint> m_textures[texture_units];
+	cached_value<bool> m_blend;
+	cached_value<bool> m_cull_face;
+	cached_value<GLenum> m_cull_face_mode;
+	cached_value<float> m_line_width;
+	cached_value<viewport_value> m_viewport;
+	cached_value<GLint> m_unpack_alignment;
+	cached_value<GLint> m_pack_alignment;
+
+	template <typename T>
+	static T query(GLenum pname)
+	{
+		if constexpr (std::is_same_v<T, bool>)
+		{
+			GLboolean res;
+			glGetBooleanv(pname, &res);
+			return res;
+		}
+		else if constexpr (std::is_same_v<T, float>)
+		{
+			GLfloat res;
+			glGetFloatv(pname, &res);
+			return res;
+		}
+		else if constexpr (std::is_same_v<T, viewport_value>)
+		{
+			viewport_value res;
+			glGetIntegerv(pname, &res.x);
+			return res;
+		}
+		else
+		{
+			GLint res;
+			glGetIntegerv(pname, &res);
+			return static_cast<T>(res);
+		}
+	}
+
+	template <typename T>
+	static T get(cached_value<T> &slot, GLenum pname, [[maybe_unused]] const char *name)
+	{
+		if (!slot.known)
+		{
+			slot.value = query<T>(pname);
+			slot.known = true;
+		}
+#ifdef SGL_CHECK_GL_STATE
+		else if (query<T>(pname) != slot.value)
+		{
+			log_error(error(std::string("Cached GL state is out of date: ") + name + '.', error_code::uknown_error));
+			slot.value = query<T>(pname);
+		}
+#endif
+		return slot.value;
+	}
+
+	// returns true if the value changed and GL needs to be called.
+	// With SGL_CHECK_GL_STATE, a cached value that would skip the call is compared against GL first, and rebound if it is stale
+	template <typename T>
+	static bool set(cached_value<T> &slot, T value, [[maybe_unused]] GLenum pname, [[maybe_unused]] const char *name)
+	{
+		if (slot.known && slot.value == value)
+		{
+#ifdef SGL_CHECK_GL_STATE
+			if (query<T>(pname) == value)
+				return false;
+			log_error(error(std::string("Cached GL state is out of date, binding again: ") + name + '.', error_code::uknown_error));
+			return true;
+#else
+			return false;
+#endif
+		}
+		slot.value = value;
+		slot.known = true;
+		return true;
+	}
+
+	// set for an indexed uniform buffer binding, which is queried with glGetIntegeri_v
+	inline bool set_base(GLuint index, GLuint id)
+	{
+		cached_value<GLuint> &slot = m_uniform_buffer_bases[index];
+		if (slot.known && slot.value == id)
+		{
+#ifdef SGL_CHECK_GL_STATE
+			GLint bound;
+			glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, index, &bound);
+			if (static_cast<GLuint>(bound) == id)
+				return false;
+			log_error(error("Cached GL state is out of date, binding again: uniform buffer base.", error_code::uknown_error));
+			return true;
+#else
+			return false;
+#endif
+		}
+		slot.value = id;
+		slot.known = true;
+		return true;
+	}
+
+	static void forget(cached_value<GLuint> &slot, GLuint id)
+	{
+		if (slot.known && slot.value == id)
+			slot.value = 0;
+	}
+
+	inline cached_value<GLuint> *buffer_slot(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_ARRAY_BUFFER:
+			return &m_array_buffer;
+		case GL_ELEMENT_ARRAY_BUFFER:
+			return &m_element_buffer;
+		case GL_UNIFORM_BUFFER:
+			return &m_uniform_buffer;
+		}
+		return nullptr;
+	}
+
+	static GLenum binding_of(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_ELEMENT_ARRAY_BUFFER:
+			return GL_ELEMENT_ARRAY_BUFFER_BINDING;
+		case GL_UNIFORM_BUFFER:
+			return GL_UNIFORM_BUFFER_BINDING;
+		case GL_SHADER_STORAGE_BUFFER:
+			return GL_SHADER_STORAGE_BUFFER_BINDING;
+		case GL_COPY_READ_BUFFER:
+			return GL_COPY_READ_BUFFER_BINDING;
+		case GL_COPY_WRITE_BUFFER:
+			return GL_COPY_WRITE_BUFFER_BINDING;
+		}
+		return GL_ARRAY_BUFFER_BINDING;
+	}
+};
+
+// state of the current context
+inline gl_state &state()
+{
+	static gl_state res;
+	return res;
+}
+
+DETAIL_END
+
+SGL_END
@@ -0,0 +1,342 @@
+#pragma once
+#include "mat.h"
+
+#include <span>
+#include <ranges>
+#include <vector>
+#include <execution>
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+
+SGL_BEG
+
+/// @brief non-owning structure-of-arrays view of points, one contiguous float array per axis
+/// @tparam dim dimension of the points
+template <vec_len dim>
+struct soa_view
+{
+	float *axes[dim];
+	std::size_t count;
+
+	inline std::size_t size() const { return count; }
+
+	inline vec<float, dim> get(std::size_t i) const
+	{
+		vec<float, dim> res;
+		for (vec_len a = 0; a < dim; ++a)
+			res[a] = axes[a][i];
+		return res;
+	}
+
+	inline void set(std::size_t i, vec<float, dim> v) const
+	{
+		for (vec_len a = 0; a < dim; ++a)
+			axes[a][i] = v[a];
+	}
+};
+
+/// @brief owning structure-of-arrays point buffer. This is the fastest layout for the batch functions below
+/// @tparam dim dimension of the points
+template <vec_len dim>
+class soa_buffer
+{
+public:
+	static_assert(dim >= 2 && dim <= 4, "Dimension must be between two and four");
+
+	soa_buffer() = default;
+	inline soa_buffer(std::size_t count) { resize(count); }
+	inline soa_buffer(std::span<const vec<float, dim>> pts) { load(pts); }
+
+	inline void resize(std::size_t count)
+	{
+		for (auto &axis : m_axes)
+			axis.resize(count);
+	}
+
+	inline std::size_t size() const { return m_axes[0].size(); }
+
+	inline float *axis(vec_len a) { return m_axes[a].data(); }
+	inline const float *axis(vec_len a) const { return m_axes[a].data(); }
+
+	inline soa_view<dim> view()
+	{
+		soa_view<dim> res;
+		for (vec_len a = 0; a < dim; ++a)
+			res.axes[a] = m_axes[a].data();
+		res.count = size();
+		return res;
+	}
+
+	inline operator soa_view<dim>() { return view(); }
+
+	// copy points in (resizes to pts.size())
+	inline void load(std::span<const vec<float, dim>> pts)
+	{
+		resize(pts.size());
+		for (std::size_t i = 0; i < pts.size(); ++i)
+			for (vec_len a = 0; a < dim; ++a)
+				m_axes[a][i] = pts[i][a];
+	}
+
+	// copy points out, pts must hold at least size() points
+	inline void store(std::span<vec<float, dim>> pts) const
+	{
+		for (std::size_t i = 0; i < size(); ++i)
+			for (vec_len a = 0; a < dim; ++a)
+				pts[i][a] = m_axes[a][i];
+	}
+
+private:
+	std::vector<float> m_axes[dim];
+};
+
+DETAIL_BEG
+
+template <typename Policy>
+concept Execution_Policy = std::is_execution_policy_v<std::remove_cvref_t<Policy>>;
+
+// dimension of a float point type, 0 for anything else
+template <typename T>
+inline constexpr vec_len point_dim = 0;
+template <vec_len dim>
+inline constexpr vec_len point_dim<vec<float, dim>> = dim;
+
+// contiguous ranges of float points (std::vector, std::array, c arrays, std::span), so callers don't have to spell out a span
+template <typename Range>
+concept Point_Range = std::ranges::contiguous_range<Range> && std::ranges::sized_range<Range> && point_dim<std::ranges::range_value_t<Range>> != 0;
+
+template <typename Range>
+concept Mutable_Point_Range = Point_Range<Range> && !std::is_const_v<std::remove_reference_t<std::ranges::range_reference_t<Range>>>;
+
+template <typename Range>
+using point_span = std::span<std::remove_reference_t<std::ranges::range_reference_t<Range>>>;
+
+template <typename Range>
+point_span<Range> as_span(Range &pts)
+{
+	return {std::ranges::data(pts), std::ranges::size(pts)};
+}
+
+// points per task. Small enough to balance between threads, large enough to hide scheduling cost
+inline constexpr std::size_t batch_chunk = 4096;
+
+// calls fn(begin, end) over [0, count) in chunks, distributed according to policy
+template <typename Policy, typename Fn>
+void for_each_chunk(Policy &&policy, std::size_t count, Fn &&fn)
+{
+	if (count <= batch_chunk)
+	{
+		fn(std::size_t{}, count);
+		return;
+	}
+
+	std::vector<std::size_t> starts((count + batch_chunk - 1) / batch_chunk);
+	for (std::size_t i = 0; i < starts.size(); ++i)
+		starts[i] = i * batch_chunk;
+
+	std::for_each(std::forward<Policy>(policy), starts.begin(), starts.end(), [&](std::size_t beg)
+	{
+		fn(beg, std::min(beg + batch_chunk, count));
+	});
+}
+
+// p = l * p + t for every point, l given column-major
+template <vec_len dim>
+struct affine_op
+{
+	vec<float, dim> l[dim];
+	vec<float, dim> t;
+
+	inline vec<float, dim> operator()(vec<float, dim> p) const
+	{
+		vec<float, dim> res = t;
+		for (vec_len a = 0; a < dim; ++a)
+			res += l[a] * p[a];
+		return res;
+	}
+};
+
+template <vec_len dim>
+affine_op<dim> make_affine_op(const mat4 &m)
+{
+	affine_op<dim> res;
+	for (vec_len a = 0; a < dim; ++a)
+		res.l[a] = m[a];
+	res.t = m[3];
+	return res;
+}
+
+template <vec_len dim>
+void apply_affine(const affine_op<dim> &op, vec<float, dim> *pts, std::size_t beg, std::size_t end)
+{
+	for (std::size_t i = beg; i < end; ++i)
+		pts[i] = op(pts[i]);
+}
+
+template <vec_len dim>
+void apply_affine(const affine_op<dim> &op, const soa_view<dim> &pts, std::size_t beg, std::size_t end)
+{
+	std::size_t i = beg;
+#ifdef SGL_SIMD
+	simd::f4 l[dim][dim];
+	simd::f4 t[dim];
+	for (vec_len out = 0; out < dim; ++out)
+	{
+		t[out] = simd::set1(op.t[out]);
+		for (vec_len in = 0; in < dim; ++in)
+			l[in][out] = simd::set1(op.l[in][out]);
+	}
+
+	for (; i + 4 <= end; i += 4)
+	{
+		simd::f4 in[dim];
+		for (vec_len a = 0; a < dim; ++a)
+			in[a] = simd::load(pts.axes[a] + i);
+
+		for (vec_len out = 0; out < dim; ++out)
+		{
+			simd::f4 acc = t[out];
+			for (vec_len a = 0; a < dim; ++a)
+				acc = simd::madd(l[a][out], in[a], acc);
+			simd::store(pts.axes[out] + i, acc);
+		}
+	}
+#endif
+	for (; i < end; ++i)
+		pts.set(i, op(pts.get(i)));
+}
+
+template <typename Policy, typename Points, vec_len dim>
+void batch_affine(Policy &&policy, const Points &pts, std::size_t count, const affine_op<dim> &op)
+{
+	for_each_chunk(std::forward<Policy>(policy), count, [&](std::size_t beg, std::size_t end)
+	{
+		apply_affine(op, pts, beg, end);
+	});
+}
+
+// rotation of angle rads about axis around origin as an affine_op
+inline affine_op<3> make_rot_op(float rads, vec3 axis, vec3 origin)
+{
+	mat3 r = rot3x3(rads, axis);
+	affine_op<3> res{{r[0], r[1], r[2]}, origin - r * origin};
+	return res;
+}
+
+inline affine_op<2> make_rotate_op(float rads, vec2 origin)
+{
+	float c = std::cos(rads);
+	float s = std::sin(rads);
+	affine_op<2> res{{{c, s}, {-s, c}}, {}};
+	res.t = origin - res(origin);
+	return res;
+}
+
+DETAIL_END
+
+// the overloads below mirror the iterator versions in mat.h, but take an execution policy (std::execution::seq/par/par_unseq/unseq)
+// work is split into chunks that run according to the policy
+// soa_view versions run with explicit simd, versions taking a contiguous range of points rely on the compiler's vectorizer
+
+template <detail::Execution_Policy Policy, detail::Mutable_Point_Range Points>
+void transform_pts(Policy &&policy, Points &&points, const mat4 &mat)
+{
+	constexpr vec_len dim = detail::point_dim<std::ranges::range_value_t<Points>>;
+	auto pts = detail::as_span(points);
+	if constexpr (dim == 4)
+	{
+		detail::for_each_chunk(std::forward<Policy>(policy), pts.size(), [&](std::size_t beg, std::size_t end)
+		{
+			for (std::size_t i = beg; i < end; ++i)
+				pts[i] = mat * pts[i];
+		});
+	}
+	else
+		detail::batch_affine(std::forward<Policy>(policy), pts.data(), pts.size(), detail::make_affine_op<dim>(mat));
+}
+
+template <detail::Execution_Policy Policy, vec_len dim>
+void transform_pts(Policy &&policy, soa_view<dim> pts, const mat4 &mat)
+{
+	static_assert(dim == 2 || dim == 3, "Dimension must be two or three dimensional");
+	detail::batch_affine(std::forward<Policy>(policy), pts, pts.size(), detail::make_affine_op<dim>(mat));
+}
+
+template <detail::Execution_Policy Policy, detail::Mutable_Point_Range Points>
+void translate(Policy &&policy, Points &&points, std::ranges::range_value_t<Points> offset)
+{
+	auto pts = detail::as_span(points);
+	detail::for_each_chunk(std::forward<Policy>(policy), pts.size(), [&](std::size_t beg, std::size_t end)
+	{
+		for (std::size_t i = beg; i < end; ++i)
+			pts[i] += offset;
+	});
+}
+
+template <detail::Execution_Policy Policy, vec_len dim>
+void translate(Policy &&policy, soa_view<dim> pts, vec<float, dim> offset)
+{
+	detail::for_each_chunk(std::forward<Policy>(policy), pts.size(), [&](std::size_t beg, std::size_t end)
+	{
+		for (vec_len a = 0; a < dim; ++a)
+		{
+			float *axis = pts.axes[a];
+			float off = offset[a];
+			for (std::size_t i = beg; i < end; ++i)
+				axis[i] += off;
+		}
+	});
+}
+
+// rotate around origin
+template <detail::Execution_Policy Policy>
+void rotate(Policy &&policy, std::span<vec2> pts, float rads, vec2 origin)
+{
+	detail::batch_affine(std::forward<Policy>(policy), pts.data(), pts.size(), detail::make_rotate_op(rads, origin));
+}
+
+// rotate around origin
+template <detail::Execution_Policy Policy>
+void rotate(Policy &&policy, soa_view<2> pts, float rads, vec2 origin)
+{
+	detail::batch_affine(std::forward<Policy>(policy), pts, pts.size(), detail::make_rotate_op(rads, origin));
+}
+
+// rotate about axis around origin
+template <detail::Execution_Policy Policy>
+void rot(Policy &&policy, std::span<vec3> pts, float rads, vec3 axis, vec3 origin)
+{
+	detail::batch_affine(std::forward<Policy>(policy), pts.data(), pts.size(), detail::make_rot_op(rads, axis, origin));
+}
+
+// rotate about axis around origin
+template <detail::Execution_Policy Policy>
+void rot(Policy &&policy, soa_view<3> pts, float rads, vec3 axis, vec3 origin)
+{
+	detail::batch_affine(std::forward<Policy>(policy), pts, pts.size(), detail::make_rot_op(rads, axis, origin));
+}
+
+template <detail::Execution_Policy Policy, detail::Point_Range Points>
+std::ranges::range_value_t<Points> center(Policy &&policy, Points &&points)
+{
+	constexpr vec_len dim = detail::point_dim<std::ranges::range_value_t<Points>>;
+	auto pts = detail::as_span(points);
+	if (pts.empty())
+		return {};
+	vec<double, dim> sum = std::reduce(std::forward<Policy>(policy), pts.begin(), pts.end(), vec<double, dim>{}, [](auto a, auto b) { return vec<double, dim>(a) + vec<double, dim>(b); });
+	return sum / static_cast<double>(pts.size());
+}
+
+template <detail::Execution_Policy Policy, vec_len dim>
+vec<float, dim> center(Policy &&policy, soa_view<dim> pts)
+{
+	vec<float, dim> res;
+	if (!pts.size())
+		return res;
+	for (vec_len a = 0; a < dim; ++a)
+		res[a] = static_cast<float>(std::reduce(policy, pts.axes[a], pts.axes[a] + pts.size(), 0.0) / pts.size());
+	return res;
+}
+
+SGL_END
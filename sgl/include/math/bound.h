@@ -14,6 +14,12 @@ struct bound
 	}
 };
 
+struct sphere
+{
+	vec3 center;
+	float radius;
+};
+
 struct rect
 {
 	vec2 min;
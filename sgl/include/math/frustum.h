@@ -0,0 +1,229 @@
+#pragma once
+#include "mat.h"
+#include "bound.h"
+
+#include <span>
+
+SGL_BEG
+
+/// @brief view frustum as six inward facing planes, used to cull objects that can't be seen
+class frustum
+{
+public:
+	// a frustum that contains everything
+	inline frustum()
+	{
+		for (int i = 0; i < plane_count; ++i)
+			m_nx[i] = m_ny[i] = m_nz[i] = m_ax[i] = m_ay[i] = m_az[i] = 0, m_d[i] = 1;
+	}
+
+	/// @brief extract the frustum planes from a combined matrix
+	/// @param view_proj projection * view for world space planes, or just projection for view space planes
+	inline explicit frustum(const mat4 &view_proj) : frustum() { set(view_proj); }
+
+	inline void set(const mat4 &view_proj)
+	{
+		// row i of view_proj is (m[0][i], m[1][i], m[2][i], m[3][i])
+		auto row = [&](vec_len i) { return vec4{view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]}; };
+		vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+		// left, right, bottom, top, near, far
+		vec4 planes[6] = {r3 + r0, r3 - r0, r3 + r1, r3 - r1, r3 + r2, r3 - r2};
+		for (int i = 0; i < 6; ++i)
+		{
+			vec4 p = planes[i];
+			float len = magnitude(vec3(p));
+			if (len > 0)
+				p = p / len;
+
+			m_nx[i] = p.x;
+			m_ny[i] = p.y;
+			m_nz[i] = p.z;
+			m_d[i] = p.w;
+			m_ax[i] = std::abs(p.x);
+			m_ay[i] = std::abs(p.y);
+			m_az[i] = std::abs(p.z);
+		}
+	}
+
+	/// @brief get plane i as (normal, distance), i in order of left, right, bottom, top, near, far
+	inline vec4 plane(int i) const { return {m_nx[i], m_ny[i], m_nz[i], m_d[i]}; }
+
+	/// @return false if the box is fully outside of the frustum
+	inline bool intersects(const bound &box) const
+	{
+		vec3 e = box.dims / 2;
+		return test_box(box.min + e, e);
+	}
+
+	/// @return false if the sphere is fully outside of the frustum
+	inline bool intersects(const sphere &s) const
+	{
+#ifdef SGL_SIMD
+		namespace simd = detail::simd;
+		simd::f4 cx = simd::set1(s.center.x), cy = simd::set1(s.center.y), cz = simd::set1(s.center.z);
+		simd::f4 nr = simd::set1(-s.radius);
+		for (int i = 0; i < plane_count; i += 4)
+		{
+			simd::f4 dist = simd::madd(simd::load(m_nx + i), cx, simd::load(m_d + i));
+			dist = simd::madd(simd::load(m_ny + i), cy, dist);
+			dist = simd::madd(simd::load(m_nz + i), cz, dist);
+			if (simd::any_less(dist, nr))
+				return false;
+		}
+		return true;
+#else
+		for (int i = 0; i < 6; ++i)
+			if (m_nx[i] * s.center.x + m_ny[i] * s.center.y + m_nz[i] * s.center.z + m_d[i] < -s.radius)
+				return false;
+		return true;
+#endif
+	}
+
+	/// @brief test a box given in the local space of model
+	/// @return false if the transformed box is fully outside of the frustum
+	inline bool intersects(const bound &local, const mat4 &model) const
+	{
+		vec3 e = local.dims / 2;
+		vec3 c = local.min + e;
+
+		// world aabb enclosing the transformed box
+		vec3 wc = vec3(model[3]) + vec3(model[0]) * c.x + vec3(model[1]) * c.y + vec3(model[2]) * c.z;
+		vec3 we;
+		for (vec_len i = 0; i < 3; ++i)
+			we[i] = std::abs(model[0][i]) * e.x + std::abs(model[1][i]) * e.y + std::abs(model[2][i]) * e.z;
+
+		return test_box(wc, we);
+	}
+
+	/// @brief test many boxes at once
+	/// @param visible visible[i] is set to whether boxes[i] intersects. Must hold at least boxes.size() elements
+	/// @return number of visible boxes
+	inline std::size_t intersects(std::span<const bound> boxes, std::span<bool> visible) const
+	{
+		std::size_t count = 0;
+		std::size_t i = 0;
+#ifdef SGL_SIMD
+		namespace simd = detail::simd;
+		// four boxes per pass, transposed so each lane holds one box and each plane is one broadcast
+		alignas(16) float cx[4], cy[4], cz[4], ex[4], ey[4], ez[4];
+		simd::f4 zero = simd::set1(0);
+		for (; boxes.size() - i >= 4; i += 4)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				const bound &box = boxes[i + j];
+				ex[j] = box.dims.x / 2;
+				ey[j] = box.dims.y / 2;
+				ez[j] = box.dims.z / 2;
+				cx[j] = box.min.x + ex[j];
+				cy[j] = box.min.y + ey[j];
+				cz[j] = box.min.z + ez[j];
+			}
+
+			simd::f4 bcx = simd::load(cx), bcy = simd::load(cy), bcz = simd::load(cz);
+			simd::f4 bex = simd::load(ex), bey = simd::load(ey), bez = simd::load(ez);
+			int outside = 0;
+			for (int p = 0; p < 6; ++p)
+			{
+				simd::f4 dist = simd::madd(simd::set1(m_nx[p]), bcx, simd::set1(m_d[p]));
+				dist = simd::madd(simd::set1(m_ny[p]), bcy, dist);
+				dist = simd::madd(simd::set1(m_nz[p]), bcz, dist);
+				dist = simd::madd(simd::set1(m_ax[p]), bex, dist);
+				dist = simd::madd(simd::set1(m_ay[p]), bey, dist);
+				dist = simd::madd(simd::set1(m_az[p]), bez, dist);
+				outside |= simd::less_mask(dist, zero);
+			}
+
+			for (int j = 0; j < 4; ++j)
+				count += visible[i + j] = !(outside >> j & 1);
+		}
+#endif
+		for (; i < boxes.size(); ++i)
+			count += visible[i] = intersects(boxes[i]);
+		return count;
+	}
+
+	/// @brief test many spheres at once
+	/// @param visible visible[i] is set to whether spheres[i] intersects. Must hold at least spheres.size() elements
+	/// @return number of visible spheres
+	inline std::size_t intersects(std::span<const sphere> spheres, std::span<bool> visible) const
+	{
+		std::size_t count = 0;
+		std::size_t i = 0;
+#ifdef SGL_SIMD
+		namespace simd = detail::simd;
+		alignas(16) float cx[4], cy[4], cz[4], nr[4];
+		for (; spheres.size() - i >= 4; i += 4)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				const sphere &s = spheres[i + j];
+				cx[j] = s.center.x;
+				cy[j] = s.center.y;
+				cz[j] = s.center.z;
+				nr[j] = -s.radius;
+			}
+
+			simd::f4 scx = simd::load(cx), scy = simd::load(cy), scz = simd::load(cz), snr = simd::load(nr);
+			int outside = 0;
+			for (int p = 0; p < 6; ++p)
+			{
+				simd::f4 dist = simd::madd(simd::set1(m_nx[p]), scx, simd::set1(m_d[p]));
+				dist = simd::madd(simd::set1(m_ny[p]), scy, dist);
+				dist = simd::madd(simd::set1(m_nz[p]), scz, dist);
+				outside |= simd::less_mask(dist, snr);
+			}
+
+			for (int j = 0; j < 4; ++j)
+				count += visible[i + j] = !(outside >> j & 1);
+		}
+#endif
+		for (; i < spheres.size(); ++i)
+			count += visible[i] = intersects(spheres[i]);
+		return count;
+	}
+
+private:
+	// six planes padded to eight so they can be tested four at a time, padding planes contain everything
+	static constexpr int plane_count = 8;
+
+	// planes in structure-of-arrays form, a is the absolute value of the normal
+	alignas(16) float m_nx[plane_count];
+	alignas(16) float m_ny[plane_count];
+	alignas(16) float m_nz[plane_count];
+	alignas(16) float m_d[plane_count];
+	alignas(16) float m_ax[plane_count];
+	alignas(16) float m_ay[plane_count];
+	alignas(16) float m_az[plane_count];
+
+	// box is outside when it is fully behind any plane: dot(n, c) + d < -dot(abs(n), e)
+	inline bool test_box(vec3 c, vec3 e) const
+	{
+#ifdef SGL_SIMD
+		namespace simd = detail::simd;
+		simd::f4 cx = simd::set1(c.x), cy = simd::set1(c.y), cz = simd::set1(c.z);
+		simd::f4 ex = simd::set1(e.x), ey = simd::set1(e.y), ez = simd::set1(e.z);
+		simd::f4 zero = simd::set1(0);
+		for (int i = 0; i < plane_count; i += 4)
+		{
+			simd::f4 dist = simd::madd(simd::load(m_nx + i), cx, simd::load(m_d + i));
+			dist = simd::madd(simd::load(m_ny + i), cy, dist);
+			dist = simd::madd(simd::load(m_nz + i), cz, dist);
+			dist = simd::madd(simd::load(m_ax + i), ex, dist);
+			dist = simd::madd(simd::load(m_ay + i), ey, dist);
+			dist = simd::madd(simd::load(m_az + i), ez, dist);
+			if (simd::any_less(dist, zero))
+				return false;
+		}
+		return true;
+#else
+		for (int i = 0; i < 6; ++i)
+			if (m_nx[i] * c.x + m_ny[i] * c.y + m_nz[i] * c.z + m_d[i] + m_ax[i] * e.x + m_ay[i] * e.y + m_az[i] * e.z < 0)
+				return false;
+		return true;
+#endif
+	}
+};
+
+SGL_END
@@ -1,6 +1,9 @@
 #pragma once
 #include "vec.h"
+#include "numerics.h"
+#include "simd.h"
 #include <iterator>
+#include <type_traits>
 
 SGL_BEG
 template <typename T, vec_len w, vec_len h>
@@ -41,6 +44,16 @@ struct mat
 	template <typename OT>
 	constexpr mat &operator*=(const mat<OT, w, w> &o)
 	{
+#ifdef SGL_SIMD
+		if constexpr (std::is_same_v<T, float> && std::is_same_v<OT, float> && w == 4 && h == 4)
+		{
+			if (!std::is_constant_evaluated())
+			{
+				detail::simd::mat4_mul(data[0].data(), o[0].data(), data[0].data());
+				return *this;
+			}
+		}
+#endif
 		for (vec_len row = 0; row < height(); ++row)
 		{
 			// to be non-destructive
@@ -111,6 +124,17 @@ constexpr auto operator*(const mat<T, w1, h1> &a, const mat<T1, w2, w1> &b)
 {
 	mat<decltype(float{} * T{} * T1{}), w2, h1> res;
 
+#ifdef SGL_SIMD
+	if constexpr (std::is_same_v<T, float> && std::is_same_v<T1, float> && w1 == 4 && h1 == 4 && w2 == 4)
+	{
+		if (!std::is_constant_evaluated())
+		{
+			detail::simd::mat4_mul(a[0].data(), b[0].data(), res[0].data());
+			return res;
+		}
+	}
+#endif
+
 	for (vec_len a_row = 0; a_row < a.height(); ++a_row)
 	{
 		for (vec_len b_col = 0; b_col < b.width(); ++b_col)
@@ -168,6 +192,17 @@ constexpr auto operator*(const mat<M, 3, 3> &a, vec<V, 3> b)
 template <typename M, typename V>
 constexpr auto operator*(const mat<M, 4, 4> &a, vec<V, 4> b)
 {
+#ifdef SGL_SIMD
+	if constexpr (std::is_same_v<M, float> && std::is_same_v<V, float>)
+	{
+		if (!std::is_constant_evaluated())
+		{
+			vec<float, 4> res;
+			detail::simd::mat4_mul_vec(a[0].data(), b.data(), res.data());
+			return res;
+		}
+	}
+#endif
 	vec<decltype(M{} * V{}), 4> res{
 		a[0].x * b.x + a[1].x * b.y + a[2].x * b.z + a[3].x * b.w,
 		a[0].y * b.x + a[1].y * b.y + a[2].y * b.z + a[3].y * b.w,
@@ -177,6 +212,21 @@ constexpr auto operator*(const mat<M, 4, 4> &a, vec<V, 4> b)
 	return res;
 }
 
+template <typename AT, typename BT, vec_len w, vec_len h>
+inline bool operator==(const mat<AT, w, h> &a, const mat<BT, w, h> &b)
+{
+	for (vec_len i = 0; i < w; ++i)
+		if (a[i] != b[i])
+			return false;
+	return true;
+}
+
+template <typename AT, typename BT, vec_len w, vec_len h>
+inline bool operator!=(const mat<AT, w, h> &a, const mat<BT, w, h> &b)
+{
+	return !(a == b);
+}
+
 template <typename T>
 using to_float = decltype(T{} * float{});
 
@@ -186,7 +236,7 @@ constexpr mat<to_float<T>, 4, 4> perspective(T fovy, T aspect, T _near, T _far)
 	using tp = to_float<T>;
 	tp n = _near;
 	tp f = _far;
-	tp t = std::tan(fovy / 2.f) * n;
+	tp t = sgl::tan(fovy / 2.f) * n;
 	tp b = -t;
 	tp r = t * aspect;
 	tp l = b * aspect;
@@ -235,8 +285,8 @@ constexpr mat<to_float<T>, 4, 4> x_rot(T rads)
 	using t = to_float<T>;
 	mat<t, 4, 4> res {
 		vec<t, 4>{1.f, 0.f, 0.f, 0.f},
-		vec<t, 4>{0.f, std::cos(rads), std::sin(rads), 0.f},
-		vec<t, 4>{0.f, -std::sin(rads), std::cos(rads), 0.f},
+		vec<t, 4>{0.f, sgl::cos(rads), sgl::sin(rads), 0.f},
+		vec<t, 4>{0.f, -sgl::sin(rads), sgl::cos(rads), 0.f},
 		vec<t, 4>{0.f, 0.f, 0.f, 1.f},
 	};
 
@@ -247,8 +297,8 @@ template <typename T>
 constexpr mat<to_float<T>, 4, 4> y_rot(T rads)
 {
 	using t = to_float<T>;
-	auto c = std::cos(rads);
-	auto s = std::sin(rads);
+	auto c = sgl::cos(rads);
+	auto s = sgl::sin(rads);
 
 	mat<t, 4, 4> res {
 		vec<t, 4>{c, 0.f, -s, 0.f},
@@ -264,8 +314,8 @@ template <typename T>
 constexpr mat<to_float<T>, 4, 4> z_rot(T rads)
 {
 	using t = to_float<T>;
-	auto c = std::cos(rads);
-	auto s = std::sin(rads);
+	auto c = sgl::cos(rads);
+	auto s = sgl::sin(rads);
 
 	mat<t, 4, 4> res {
 		vec<t, 4>{c, s, 0.f, 0.f},
@@ -284,8 +334,8 @@ constexpr mat<to_float<T>, 4, 4> rot(T rads, vec<T, 3> axis)
 
 	auto u = normalize(axis);
 
-	auto c = std::cos(rads);
-	auto s = std::sin(rads);
+	auto c = sgl::cos(rads);
+	auto s = sgl::sin(rads);
 	mat<t, 4, 4> res {
 		vec<t, 4>{c + u.x * u.x * (1 - c), u.y * u.x * (1 - c) + u.z * s, u.z * u.x * (1 - c) - u.y * s, 0.f},
 		vec<t, 4>{u.x * u.y * (1 - c) - u.z * s, c + u.y * u.y * (1 - c), u.z * u.y * (1 - c) + u.x * s, 0.f},
@@ -296,13 +346,32 @@ constexpr mat<to_float<T>, 4, 4> rot(T rads, vec<T, 3> axis)
 	return res;
 }
 
+// upper 3x3 of rot(rads, axis)
+template <typename T = float>
+constexpr mat<to_float<T>, 3, 3> rot3x3(T rads, vec<T, 3> axis)
+{
+	using t = to_float<T>;
+
+	auto u = normalize(axis);
+
+	auto c = sgl::cos(rads);
+	auto s = sgl::sin(rads);
+	mat<t, 3, 3> res {
+		vec<t, 3>{c + u.x * u.x * (1 - c), u.y * u.x * (1 - c) + u.z * s, u.z * u.x * (1 - c) - u.y * s},
+		vec<t, 3>{u.x * u.y * (1 - c) - u.z * s, c + u.y * u.y * (1 - c), u.z * u.y * (1 - c) + u.x * s},
+		vec<t, 3>{u.x * u.z * (1 - c) + u.y * s, u.y * u.z * (1 - c) - u.x * s, c + u.z * u.z * (1 - c)},
+	};
+
+	return res;
+}
+
 template <typename T = float>
 constexpr mat<to_float<T>, 3, 3> rot2d(T rads)
 {
 	using t = to_float<T>;
 
-	auto c = std::cos(rads);
-	auto s = std::sin(rads);
+	auto c = sgl::cos(rads);
+	auto s = sgl::sin(rads);
 
 	mat<t, 3, 3> res {
 		vec<t, 3>{c, s, 0},
@@ -452,6 +521,17 @@ constexpr mat<T, h, w> transpose(const mat<T, w, h> &m)
 template <typename T>
 constexpr mat<T, 4, 4> transpose(const mat<T, 4, 4> &m)
 {
+#ifdef SGL_SIMD
+	if constexpr (std::is_same_v<T, float>)
+	{
+		if (!std::is_constant_evaluated())
+		{
+			mat<T, 4, 4> res;
+			detail::simd::mat4_transpose(m[0].data(), res[0].data());
+			return res;
+		}
+	}
+#endif
 	mat<T, 4, 4> res {{
 		{m[0][0], m[1][0], m[2][0], m[3][0]},
 		{m[0][1], m[1][1], m[2][1], m[3][1]},
@@ -526,6 +606,19 @@ constexpr mat<to_float<T>, 3, 3> cofactor(const mat<T, 3, 3> &m)
 template <typename T>
 constexpr mat<to_float<T>, 4, 4> cofactor(const mat<T, 4, 4> &m)
 {
+#ifdef SGL_SIMD
+	if constexpr (std::is_same_v<T, float>)
+	{
+		if (!std::is_constant_evaluated())
+		{
+			// the simd kernel produces the adjugate, which is the transposed cofactor matrix
+			mat<float, 4, 4> res;
+			detail::simd::mat4_adjugate(m[0].data(), res[0].data());
+			detail::simd::mat4_transpose(res[0].data(), res[0].data());
+			return res;
+		}
+	}
+#endif
 	mat<to_float<T>, 4, 4> res {{
 		{det(m[1][1], m[2][1], m[3][1],
 			 m[1][2], m[2][2], m[3][2],
@@ -583,6 +676,17 @@ constexpr mat<to_float<T>, 4, 4> cofactor(const mat<T, 4, 4> &m)
 template <typename T, vec_len w>
 constexpr mat<to_float<T>, w, w> adjoint(const mat<T, w, w> &m)
 {
+#ifdef SGL_SIMD
+	if constexpr (std::is_same_v<T, float> && w == 4)
+	{
+		if (!std::is_constant_evaluated())
+		{
+			mat<float, 4, 4> res;
+			detail::simd::mat4_adjugate(m[0].data(), res[0].data());
+			return res;
+		}
+	}
+#endif
 	auto res = transpose(cofactor(m));
 	return res;
 }
@@ -590,10 +694,140 @@ constexpr mat<to_float<T>, w, w> adjoint(const mat<T, w, w> &m)
 template <typename T, vec_len w>
 constexpr mat<to_float<T>, w, w> inverse(const mat<T, w, w> &m)
 {
+#ifdef SGL_SIMD
+	if constexpr (std::is_same_v<T, float> && w == 4)
+	{
+		if (!std::is_constant_evaluated())
+		{
+			mat<float, 4, 4> res;
+			detail::simd::mat4_inverse(m[0].data(), res[0].data());
+			return res;
+		}
+	}
+#endif
 	auto res = (1 / det(m)) * adjoint(m);
 	return res;
 }
 
+// affine transforms have a last row of (0, 0, 0, 1), which holds for any combination of translate, rot and scale
+template <typename T>
+constexpr bool is_affine(const mat<T, 4, 4> &m)
+{
+	return m[0].w == 0 && m[1].w == 0 && m[2].w == 0 && m[3].w == 1;
+}
+
+// rigid transforms are affine with orthonormal axes, only rotations and translations (see rigid_inverse)
+template <typename T>
+constexpr bool is_rigid(const mat<T, 4, 4> &m)
+{
+	using t = to_float<T>;
+	if (!is_affine(m))
+		return false;
+
+	vec<t, 3> a = m[0];
+	vec<t, 3> b = m[1];
+	vec<t, 3> c = m[2];
+	// loose enough for axes built from normalized floats
+	constexpr t tolerance = t(1e-4);
+	auto near = [](t value, t expected) { return value - expected <= tolerance && expected - value <= tolerance; };
+	return near(dot(a, a), 1) && near(dot(b, b), 1) && near(dot(c, c), 1) && near(dot(a, b), 0) && near(dot(a, c), 0) && near(dot(b, c), 0);
+}
+
+// translate(loc) * mat4(rotation) * scale(s), built directly
+template <typename T = float>
+constexpr mat<to_float<T>, 4, 4> trs(vec<T, 3> loc, const mat<T, 3, 3> &rotation, vec<T, 3> s)
+{
+	using t = to_float<T>;
+	mat<t, 4, 4> res {
+		vec<t, 4>{rotation[0] * s.x, 0.f},
+		vec<t, 4>{rotation[1] * s.y, 0.f},
+		vec<t, 4>{rotation[2] * s.z, 0.f},
+		vec<t, 4>{loc, 1.f},
+	};
+
+	return res;
+}
+
+// m = m * translate(loc)
+template <typename T, typename OT>
+constexpr mat<T, 4, 4> &post_translate(mat<T, 4, 4> &m, vec<OT, 3> loc)
+{
+	m[3] += m[0] * loc.x + m[1] * loc.y + m[2] * loc.z;
+	return m;
+}
+
+// m = m * scale(s)
+template <typename T, typename OT>
+constexpr mat<T, 4, 4> &post_scale(mat<T, 4, 4> &m, vec<OT, 3> s)
+{
+	m[0] *= s.x;
+	m[1] *= s.y;
+	m[2] *= s.z;
+	return m;
+}
+
+// m = m * l, where l is the upper 3x3 of a transform with no translation (such as rot3x3)
+template <typename T, typename OT>
+constexpr mat<T, 4, 4> &post_linear(mat<T, 4, 4> &m, const mat<OT, 3, 3> &l)
+{
+	vec<T, 4> c0 = m[0];
+	vec<T, 4> c1 = m[1];
+	vec<T, 4> c2 = m[2];
+	for (vec_len col = 0; col < 3; ++col)
+		m[col] = c0 * l[col].x + c1 * l[col].y + c2 * l[col].z;
+	return m;
+}
+
+// inverse of an affine matrix (see is_affine), roughly a quarter of the work of inverse
+template <typename T>
+constexpr mat<to_float<T>, 4, 4> affine_inverse(const mat<T, 4, 4> &m)
+{
+	using t = to_float<T>;
+	vec<t, 3> a = m[0];
+	vec<t, 3> b = m[1];
+	vec<t, 3> c = m[2];
+	vec<t, 3> p = m[3];
+
+	// rows of the inverse of the upper 3x3
+	vec<t, 3> r0 = cross(b, c);
+	vec<t, 3> r1 = cross(c, a);
+	vec<t, 3> r2 = cross(a, b);
+
+	t inv_det = 1 / dot(a, r0);
+	r0 *= inv_det;
+	r1 *= inv_det;
+	r2 *= inv_det;
+
+	mat<t, 4, 4> res {
+		vec<t, 4>{r0.x, r1.x, r2.x, 0.f},
+		vec<t, 4>{r0.y, r1.y, r2.y, 0.f},
+		vec<t, 4>{r0.z, r1.z, r2.z, 0.f},
+		vec<t, 4>{-dot(r0, p), -dot(r1, p), -dot(r2, p), 1.f},
+	};
+
+	return res;
+}
+
+// inverse of a matrix made only of rotations and translations (such as a camera view)
+template <typename T>
+constexpr mat<to_float<T>, 4, 4> rigid_inverse(const mat<T, 4, 4> &m)
+{
+	using t = to_float<T>;
+	vec<t, 3> a = m[0];
+	vec<t, 3> b = m[1];
+	vec<t, 3> c = m[2];
+	vec<t, 3> p = m[3];
+
+	mat<t, 4, 4> res {
+		vec<t, 4>{a.x, b.x, c.x, 0.f},
+		vec<t, 4>{a.y, b.y, c.y, 0.f},
+		vec<t, 4>{a.z, b.z, c.z, 0.f},
+		vec<t, 4>{-dot(a, p), -dot(b, p), -dot(c, p), 1.f},
+	};
+
+	return res;
+}
+
 template <typename T, vec_len w, vec_len h>
 T const *value(const mat<T, w, h> &m)
 {
@@ -630,7 +864,7 @@ constexpr void rotate(InputIt begin, InputIt end, float rads, sgl::vec<T, 2> ori
 	for (; begin != end; ++begin)
 	{
 		*begin -= origin;
-		*begin = mat * *begin;
+		*begin = mat * vec<T, 3>{begin->x, begin->y, 1};
 		*begin += origin;
 	}
 }
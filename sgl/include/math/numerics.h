@@ -1,4 +1,7 @@
 #pragma once
+#include <bit>
+#include <cmath>
+#include <cstdint>
 #include <limits>
 #include <type_traits>
 
@@ -23,6 +26,152 @@ constexpr T degrees(T radians)
 	return radians * 180.f / pi<T>();
 }
 
+DETAIL_BEG
+
+template <typename T>
+using math_result = std::conditional_t<std::is_integral_v<T>, double, T>;
+
+// x - k * pi/2 with k the nearest integer, evaluated in double with pi/2 split in two for accuracy
+constexpr double reduce_half_pi(double x, long long &k)
+{
+	constexpr double two_over_pi = 0.63661977236758134308;
+	constexpr double half_pi_hi = 1.57079632679489655800e+00;
+	constexpr double half_pi_lo = 6.12323399573676603587e-17;
+
+	double q = x * two_over_pi;
+	k = static_cast<long long>(q < 0 ? q - .5 : q + .5);
+	return (x - k * half_pi_hi) - k * half_pi_lo;
+}
+
+// taylor series on [-pi/4, pi/4], enough terms for double precision
+constexpr double sin_poly(double r)
+{
+	double r2 = r * r;
+	double term = r;
+	double res = r;
+	for (int i = 1; i <= 11; ++i)
+	{
+		term *= -r2 / ((2 * i) * (2 * i + 1));
+		res += term;
+	}
+	return res;
+}
+
+constexpr double cos_poly(double r)
+{
+	double r2 = r * r;
+	double term = 1;
+	double res = 1;
+	for (int i = 1; i <= 11; ++i)
+	{
+		term *= -r2 / ((2 * i - 1) * (2 * i));
+		res += term;
+	}
+	return res;
+}
+
+constexpr bool is_finite(double x)
+{
+	return x == x && x != std::numeric_limits<double>::infinity() && x != -std::numeric_limits<double>::infinity();
+}
+
+constexpr double const_sin(double x)
+{
+	if (!is_finite(x))
+		return std::numeric_limits<double>::quiet_NaN();
+	long long k;
+	double r = reduce_half_pi(x, k);
+	switch (k & 3)
+	{
+	case 0:
+		return sin_poly(r);
+	case 1:
+		return cos_poly(r);
+	case 2:
+		return -sin_poly(r);
+	default:
+		return -cos_poly(r);
+	}
+}
+
+constexpr double const_cos(double x)
+{
+	if (!is_finite(x))
+		return std::numeric_limits<double>::quiet_NaN();
+	long long k;
+	double r = reduce_half_pi(x, k);
+	switch (k & 3)
+	{
+	case 0:
+		return cos_poly(r);
+	case 1:
+		return -sin_poly(r);
+	case 2:
+		return -cos_poly(r);
+	default:
+		return sin_poly(r);
+	}
+}
+
+constexpr double const_sqrt(double x)
+{
+	if (x < 0 || x != x)
+		return std::numeric_limits<double>::quiet_NaN();
+	if (x == 0 || x == std::numeric_limits<double>::infinity())
+		return x;
+
+	// halve the exponent for the first guess, then newton-raphson until it stops improving
+	auto bits = std::bit_cast<std::uint64_t>(x);
+	double guess = std::bit_cast<double>((bits >> 1) + (std::uint64_t{1023} << 51));
+	for (int i = 0; i < 64; ++i)
+	{
+		double next = (guess + x / guess) / 2;
+		if (next == guess)
+			break;
+		guess = next;
+	}
+	return guess;
+}
+
+DETAIL_END
+
+// sin/cos/tan/sqrt that can be evaluated at compile time. At runtime they call the std versions
+template <typename T>
+constexpr detail::math_result<T> sin(T x)
+{
+	using R = detail::math_result<T>;
+	if (std::is_constant_evaluated())
+		return static_cast<R>(detail::const_sin(static_cast<double>(x)));
+	return std::sin(static_cast<R>(x));
+}
+
+template <typename T>
+constexpr detail::math_result<T> cos(T x)
+{
+	using R = detail::math_result<T>;
+	if (std::is_constant_evaluated())
+		return static_cast<R>(detail::const_cos(static_cast<double>(x)));
+	return std::cos(static_cast<R>(x));
+}
+
+template <typename T>
+constexpr detail::math_result<T> tan(T x)
+{
+	using R = detail::math_result<T>;
+	if (std::is_constant_evaluated())
+		return static_cast<R>(detail::const_sin(static_cast<double>(x)) / detail::const_cos(static_cast<double>(x)));
+	return std::tan(static_cast<R>(x));
+}
+
+template <typename T>
+constexpr detail::math_result<T> sqrt(T x)
+{
+	using R = detail::math_result<T>;
+	if (std::is_constant_evaluated())
+		return static_cast<R>(detail::const_sqrt(static_cast<double>(x)));
+	return std::sqrt(static_cast<R>(x));
+}
+
 template <typename T>
 constexpr int sgn(T val)
 {
@@ -0,0 +1,267 @@
+#pragma once
+#include "mat.h"
+#include <algorithm>
+#include <limits>
+
+SGL_BEG
+
+/// @brief rotation quaternion, (x, y, z) is the vector part and w the scalar part
+/// @tparam T floating point type
+template <typename T>
+struct quaternion
+{
+	using value_type = T;
+
+	T x, y, z, w;
+
+	// identity rotation
+	constexpr quaternion() : x{}, y{}, z{}, w{1} {}
+	constexpr quaternion(T _x, T _y, T _z, T _w) : x{_x}, y{_y}, z{_z}, w{_w} {}
+	constexpr quaternion(vec<T, 3> v, T _w) : x{v.x}, y{v.y}, z{v.z}, w{_w} {}
+
+	template <typename OT>
+	constexpr explicit quaternion(quaternion<OT> other) : x{static_cast<T>(other.x)}, y{static_cast<T>(other.y)}, z{static_cast<T>(other.z)}, w{static_cast<T>(other.w)} {}
+
+	constexpr vec<T, 3> xyz() const { return {x, y, z}; }
+
+	constexpr quaternion &operator*=(quaternion other) { return *this = *this * other; }
+
+	constexpr quaternion &operator*=(T s)
+	{
+		x *= s;
+		y *= s;
+		z *= s;
+		w *= s;
+		return *this;
+	}
+};
+
+using quat = quaternion<float>;
+using dquat = quaternion<double>;
+
+template <typename T>
+constexpr quaternion<T> operator+(quaternion<T> a, quaternion<T> b)
+{
+	return {a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
+}
+
+template <typename T>
+constexpr quaternion<T> operator-(quaternion<T> a, quaternion<T> b)
+{
+	return {a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w};
+}
+
+template <typename T>
+constexpr quaternion<T> operator-(quaternion<T> q)
+{
+	return {-q.x, -q.y, -q.z, -q.w};
+}
+
+template <typename T>
+constexpr quaternion<T> operator*(quaternion<T> q, T s)
+{
+	return {q.x * s, q.y * s, q.z * s, q.w * s};
+}
+
+template <typename T>
+constexpr quaternion<T> operator*(T s, quaternion<T> q)
+{
+	return q * s;
+}
+
+// composition, a * b rotates by b first, then by a
+template <typename T>
+constexpr quaternion<T> operator*(quaternion<T> a, quaternion<T> b)
+{
+	return {
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+	};
+}
+
+// rotate v by unit quaternion q
+template <typename T>
+constexpr vec<T, 3> operator*(quaternion<T> q, vec<T, 3> v)
+{
+	vec<T, 3> u = q.xyz();
+	vec<T, 3> t = cross(u, v) * T(2);
+	return v + t * q.w + cross(u, t);
+}
+
+template <typename T>
+constexpr bool operator==(quaternion<T> a, quaternion<T> b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+}
+
+template <typename T>
+constexpr bool operator!=(quaternion<T> a, quaternion<T> b)
+{
+	return !(a == b);
+}
+
+template <typename T>
+constexpr T dot(quaternion<T> a, quaternion<T> b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+template <typename T>
+constexpr T magnitude2(quaternion<T> q)
+{
+	return dot(q, q);
+}
+
+template <typename T>
+constexpr T magnitude(quaternion<T> q)
+{
+	return sgl::sqrt(magnitude2(q));
+}
+
+template <typename T>
+constexpr quaternion<T> normalize(quaternion<T> q)
+{
+	T m = magnitude(q);
+	if (m == 0)
+		return {};
+	return q * (T(1) / m);
+}
+
+template <typename T>
+constexpr quaternion<T> conjugate(quaternion<T> q)
+{
+	return {-q.x, -q.y, -q.z, q.w};
+}
+
+template <typename T>
+constexpr quaternion<T> inverse(quaternion<T> q)
+{
+	return conjugate(q) * (T(1) / magnitude2(q));
+}
+
+// rotation of rads about axis
+template <typename T>
+constexpr quaternion<to_float<T>> angle_axis(T rads, vec<T, 3> axis)
+{
+	using t = to_float<T>;
+	t half = static_cast<t>(rads) / 2;
+	return {normalize(vec<t, 3>(axis)) * static_cast<t>(sgl::sin(half)), static_cast<t>(sgl::cos(half))};
+}
+
+// rotation angle of unit quaternion q in [0, 2pi]
+template <typename T>
+constexpr T angle(quaternion<T> q)
+{
+	return T(2) * std::acos(std::clamp(q.w, T(-1), T(1)));
+}
+
+// rotation axis of unit quaternion q, {0, 0, 1} if q has no rotation
+template <typename T>
+constexpr vec<T, 3> axis(quaternion<T> q)
+{
+	T s2 = 1 - q.w * q.w;
+	if (s2 <= std::numeric_limits<T>::epsilon())
+		return {0, 0, 1};
+	return q.xyz() / std::sqrt(s2);
+}
+
+// normalized linear interpolation along the shortest path, cheap and accurate enough for small steps
+template <typename T>
+constexpr quaternion<T> nlerp(quaternion<T> a, quaternion<T> b, T t)
+{
+	if (dot(a, b) < 0)
+		b = -b;
+	return normalize(a + (b - a) * t);
+}
+
+// spherical linear interpolation along the shortest path, constant angular velocity
+template <typename T>
+constexpr quaternion<T> slerp(quaternion<T> a, quaternion<T> b, T t)
+{
+	T c = dot(a, b);
+	if (c < 0)
+	{
+		b = -b;
+		c = -c;
+	}
+
+	// nearly parallel, sin(theta) is too small to divide by
+	if (c > T(1) - std::numeric_limits<T>::epsilon() * 16)
+		return nlerp(a, b, t);
+
+	T theta = std::acos(c);
+	T s = std::sin(theta);
+	return a * (std::sin((1 - t) * theta) / s) + b * (std::sin(t * theta) / s);
+}
+
+// rotation matrix of unit quaternion q
+template <typename T>
+constexpr mat<T, 3, 3> rot3x3(quaternion<T> q)
+{
+	T xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	T xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	T wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+	mat<T, 3, 3> res {
+		vec<T, 3>{1 - 2 * (yy + zz), 2 * (xy + wz), 2 * (xz - wy)},
+		vec<T, 3>{2 * (xy - wz), 1 - 2 * (xx + zz), 2 * (yz + wx)},
+		vec<T, 3>{2 * (xz + wy), 2 * (yz - wx), 1 - 2 * (xx + yy)},
+	};
+
+	return res;
+}
+
+// rotation matrix of unit quaternion q
+template <typename T>
+constexpr mat<T, 4, 4> rot(quaternion<T> q)
+{
+	auto r = rot3x3(q);
+
+	mat<T, 4, 4> res {
+		vec<T, 4>{r[0].x, r[0].y, r[0].z, 0},
+		vec<T, 4>{r[1].x, r[1].y, r[1].z, 0},
+		vec<T, 4>{r[2].x, r[2].y, r[2].z, 0},
+		vec<T, 4>{0, 0, 0, 1},
+	};
+
+	return res;
+}
+
+template <typename T>
+constexpr mat<T, 4, 4> trs(vec<T, 3> loc, quaternion<T> rotation, vec<T, 3> s)
+{
+	return trs(loc, rot3x3(rotation), s);
+}
+
+// unit quaternion of the rotation part of m, m must be a pure rotation
+template <typename T>
+constexpr quaternion<T> to_quat(const mat<T, 3, 3> &m)
+{
+	T trace = m[0].x + m[1].y + m[2].z;
+	quaternion<T> res;
+	if (trace > 0)
+	{
+		T s = std::sqrt(trace + 1) * 2;
+		res = {(m[1].z - m[2].y) / s, (m[2].x - m[0].z) / s, (m[0].y - m[1].x) / s, s / 4};
+	}
+	else if (m[0].x > m[1].y && m[0].x > m[2].z)
+	{
+		T s = std::sqrt(1 + m[0].x - m[1].y - m[2].z) * 2;
+		res = {s / 4, (m[1].x + m[0].y) / s, (m[2].x + m[0].z) / s, (m[1].z - m[2].y) / s};
+	}
+	else if (m[1].y > m[2].z)
+	{
+		T s = std::sqrt(1 + m[1].y - m[0].x - m[2].z) * 2;
+		res = {(m[1].x + m[0].y) / s, s / 4, (m[2].y + m[1].z) / s, (m[2].x - m[0].z) / s};
+	}
+	else
+	{
+		T s = std::sqrt(1 + m[2].z - m[0].x - m[1].y) * 2;
+		res = {(m[2].x + m[0].z) / s, (m[2].y + m[1].z) / s, s / 4, (m[0].y - m[1].x) / s};
+	}
+	return normalize(res);
+}
+
+SGL_END
@@ -0,0 +1,274 @@
+#pragma once
+#include "macro.h"
+
+// define SGL_NO_SIMD to force the scalar paths everywhere
+#if !defined(SGL_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SGL_SIMD_SSE 1
+#define SGL_SIMD 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define SGL_SIMD_NEON 1
+#define SGL_SIMD 1
+#include <arm_neon.h>
+#endif
+#endif
+
+#ifdef SGL_SIMD
+
+SGL_BEG
+DETAIL_BEG
+
+// thin wrapper over 4-wide float registers
+// every kernel works on column-major float[16]/float[4] so that mat4/vec4 keep their plain layout
+namespace simd
+{
+#if defined(SGL_SIMD_SSE)
+	using f4 = __m128;
+
+	inline f4 load(const float *p) { return _mm_loadu_ps(p); }
+	inline void store(float *p, f4 a) { _mm_storeu_ps(p, a); }
+	inline f4 set1(float a) { return _mm_set1_ps(a); }
+	// lanes are given in memory order (x, y, z, w)
+	inline f4 set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+
+	inline f4 add(f4 a, f4 b) { return _mm_add_ps(a, b); }
+	inline f4 sub(f4 a, f4 b) { return _mm_sub_ps(a, b); }
+	inline f4 mul(f4 a, f4 b) { return _mm_mul_ps(a, b); }
+	inline f4 div(f4 a, f4 b) { return _mm_div_ps(a, b); }
+
+	// a * b + c
+	inline f4 madd(f4 a, f4 b, f4 c)
+	{
+#ifdef __FMA__
+		return _mm_fmadd_ps(a, b, c);
+#else
+		return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+	}
+
+	// {a[i0], a[i1], b[i2], b[i3]}
+	template <int i0, int i1, int i2, int i3>
+	inline f4 shuffle(f4 a, f4 b) { return _mm_shuffle_ps(a, b, _MM_SHUFFLE(i3, i2, i1, i0)); }
+
+	template <int i>
+	inline f4 splat(f4 a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(i, i, i, i)); }
+
+	inline float first(f4 a) { return _mm_cvtss_f32(a); }
+
+	// true if a[i] < b[i] in any lane
+	inline bool any_less(f4 a, f4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)) != 0; }
+
+	// bit i is set if a[i] < b[i]
+	inline int less_mask(f4 a, f4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+#elif defined(SGL_SIMD_NEON)
+	using f4 = float32x4_t;
+
+	inline f4 load(const float *p) { return vld1q_f32(p); }
+	inline void store(float *p, f4 a) { vst1q_f32(p, a); }
+	inline f4 set1(float a) { return vdupq_n_f32(a); }
+	inline f4 set(float x, float y, float z, float w)
+	{
+		float v[4] = {x, y, z, w};
+		return vld1q_f32(v);
+	}
+
+	inline f4 add(f4 a, f4 b) { return vaddq_f32(a, b); }
+	inline f4 sub(f4 a, f4 b) { return vsubq_f32(a, b); }
+	inline f4 mul(f4 a, f4 b) { return vmulq_f32(a, b); }
+	inline f4 div(f4 a, f4 b)
+	{
+#if defined(__aarch64__) || defined(_M_ARM64)
+		return vdivq_f32(a, b);
+#else
+		// two newton-raphson steps on the reciprocal estimate
+		f4 r = vrecpeq_f32(b);
+		r = vmulq_f32(vrecpsq_f32(b, r), r);
+		r = vmulq_f32(vrecpsq_f32(b, r), r);
+		return vmulq_f32(a, r);
+#endif
+	}
+
+	inline f4 madd(f4 a, f4 b, f4 c) { return vmlaq_f32(c, a, b); }
+
+	template <int i0, int i1, int i2, int i3>
+	inline f4 shuffle(f4 a, f4 b)
+	{
+		f4 res = vdupq_n_f32(vgetq_lane_f32(a, i0));
+		res = vsetq_lane_f32(vgetq_lane_f32(a, i1), res, 1);
+		res = vsetq_lane_f32(vgetq_lane_f32(b, i2), res, 2);
+		return vsetq_lane_f32(vgetq_lane_f32(b, i3), res, 3);
+	}
+
+	template <int i>
+	inline f4 splat(f4 a) { return vdupq_n_f32(vgetq_lane_f32(a, i)); }
+
+	inline float first(f4 a) { return vgetq_lane_f32(a, 0); }
+
+	// true if a[i] < b[i] in any lane
+	inline bool any_less(f4 a, f4 b)
+	{
+		uint32x4_t m = vcltq_f32(a, b);
+		uint32x2_t r = vorr_u32(vget_low_u32(m), vget_high_u32(m));
+		return (vget_lane_u32(r, 0) | vget_lane_u32(r, 1)) != 0;
+	}
+
+	// bit i is set if a[i] < b[i]
+	inline int less_mask(f4 a, f4 b)
+	{
+		uint32x4_t m = vcltq_f32(a, b);
+		return static_cast<int>((vgetq_lane_u32(m, 0) & 1) | (vgetq_lane_u32(m, 1) & 2) | (vgetq_lane_u32(m, 2) & 4) | (vgetq_lane_u32(m, 3) & 8));
+	}
+#endif
+
+	// horizontal dot product broadcast to every lane
+	inline f4 dot(f4 a, f4 b)
+	{
+		f4 m = mul(a, b);
+		f4 s = add(m, shuffle<1, 0, 3, 2>(m, m));
+		return add(s, shuffle<2, 3, 0, 1>(s, s));
+	}
+
+	// res = m * v
+	inline void mat4_mul_vec(const float *m, const float *v, float *res)
+	{
+		f4 vec = load(v);
+		f4 r = mul(load(m), splat<0>(vec));
+		r = madd(load(m + 4), splat<1>(vec), r);
+		r = madd(load(m + 8), splat<2>(vec), r);
+		r = madd(load(m + 12), splat<3>(vec), r);
+		store(res, r);
+	}
+
+	// res = a * b, res may alias a or b
+	inline void mat4_mul(const float *a, const float *b, float *res)
+	{
+		f4 a0 = load(a);
+		f4 a1 = load(a + 4);
+		f4 a2 = load(a + 8);
+		f4 a3 = load(a + 12);
+
+#if defined(SGL_SIMD_SSE) && defined(__AVX__)
+		// two result columns per iteration
+		__m256 c0 = _mm256_set_m128(a0, a0);
+		__m256 c1 = _mm256_set_m128(a1, a1);
+		__m256 c2 = _mm256_set_m128(a2, a2);
+		__m256 c3 = _mm256_set_m128(a3, a3);
+
+		__m256 r[2];
+		for (int col = 0; col < 2; ++col)
+		{
+			const float *bc = b + col * 8;
+			__m256 acc = _mm256_mul_ps(c0, _mm256_set_m128(_mm_set1_ps(bc[4]), _mm_set1_ps(bc[0])));
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(c1, _mm256_set_m128(_mm_set1_ps(bc[5]), _mm_set1_ps(bc[1]))));
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(c2, _mm256_set_m128(_mm_set1_ps(bc[6]), _mm_set1_ps(bc[2]))));
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(c3, _mm256_set_m128(_mm_set1_ps(bc[7]), _mm_set1_ps(bc[3]))));
+			r[col] = acc;
+		}
+
+		_mm256_storeu_ps(res, r[0]);
+		_mm256_storeu_ps(res + 8, r[1]);
+#else
+		f4 r[4];
+		for (int col = 0; col < 4; ++col)
+		{
+			f4 bc = load(b + col * 4);
+			f4 acc = mul(a0, splat<0>(bc));
+			acc = madd(a1, splat<1>(bc), acc);
+			acc = madd(a2, splat<2>(bc), acc);
+			acc = madd(a3, splat<3>(bc), acc);
+			r[col] = acc;
+		}
+
+		for (int col = 0; col < 4; ++col)
+			store(res + col * 4, r[col]);
+#endif
+	}
+
+	// res may alias m
+	inline void mat4_transpose(const float *m, float *res)
+	{
+		f4 c0 = load(m);
+		f4 c1 = load(m + 4);
+		f4 c2 = load(m + 8);
+		f4 c3 = load(m + 12);
+
+		f4 t0 = shuffle<0, 1, 0, 1>(c0, c1);
+		f4 t1 = shuffle<2, 3, 2, 3>(c0, c1);
+		f4 t2 = shuffle<0, 1, 0, 1>(c2, c3);
+		f4 t3 = shuffle<2, 3, 2, 3>(c2, c3);
+
+		store(res, shuffle<0, 2, 0, 2>(t0, t2));
+		store(res + 4, shuffle<1, 3, 1, 3>(t0, t2));
+		store(res + 8, shuffle<0, 2, 0, 2>(t1, t3));
+		store(res + 12, shuffle<1, 3, 1, 3>(t1, t3));
+	}
+
+	// writes the adjugate (transposed cofactor matrix) of m into res and returns det(m)
+	// res may alias m
+	inline float mat4_adjugate(const float *m, float *res)
+	{
+		f4 in0 = load(m);
+		f4 in1 = load(m + 4);
+		f4 in2 = load(m + 8);
+		f4 in3 = load(m + 12);
+
+		// 2x2 sub-determinants of the last two columns, arranged so that lane 0 belongs to column 0
+		// of the result and lanes 1-3 belong to columns 1-3
+		auto factor = [&](auto swp0a, auto swp0b, auto swp00, auto swp03)
+		{
+			f4 swp01 = shuffle<0, 0, 0, 2>(swp0a, swp0a);
+			f4 swp02 = shuffle<0, 0, 0, 2>(swp0b, swp0b);
+			return sub(mul(swp00, swp01), mul(swp02, swp03));
+		};
+
+		f4 fac0 = factor(shuffle<3, 3, 3, 3>(in3, in2), shuffle<2, 2, 2, 2>(in3, in2), shuffle<2, 2, 2, 2>(in2, in1), shuffle<3, 3, 3, 3>(in2, in1));
+		f4 fac1 = factor(shuffle<3, 3, 3, 3>(in3, in2), shuffle<1, 1, 1, 1>(in3, in2), shuffle<1, 1, 1, 1>(in2, in1), shuffle<3, 3, 3, 3>(in2, in1));
+		f4 fac2 = factor(shuffle<2, 2, 2, 2>(in3, in2), shuffle<1, 1, 1, 1>(in3, in2), shuffle<1, 1, 1, 1>(in2, in1), shuffle<2, 2, 2, 2>(in2, in1));
+		f4 fac3 = factor(shuffle<3, 3, 3, 3>(in3, in2), shuffle<0, 0, 0, 0>(in3, in2), shuffle<0, 0, 0, 0>(in2, in1), shuffle<3, 3, 3, 3>(in2, in1));
+		f4 fac4 = factor(shuffle<2, 2, 2, 2>(in3, in2), shuffle<0, 0, 0, 0>(in3, in2), shuffle<0, 0, 0, 0>(in2, in1), shuffle<2, 2, 2, 2>(in2, in1));
+		f4 fac5 = factor(shuffle<1, 1, 1, 1>(in3, in2), shuffle<0, 0, 0, 0>(in3, in2), shuffle<0, 0, 0, 0>(in2, in1), shuffle<1, 1, 1, 1>(in2, in1));
+
+		f4 sign_a = set(-1, 1, -1, 1);
+		f4 sign_b = set(1, -1, 1, -1);
+
+		// {m[1][i], m[0][i], m[0][i], m[0][i]}
+		auto spread = [](f4 t) { return shuffle<0, 2, 2, 2>(t, t); };
+		f4 vec0 = spread(shuffle<0, 0, 0, 0>(in1, in0));
+		f4 vec1 = spread(shuffle<1, 1, 1, 1>(in1, in0));
+		f4 vec2 = spread(shuffle<2, 2, 2, 2>(in1, in0));
+		f4 vec3 = spread(shuffle<3, 3, 3, 3>(in1, in0));
+
+		f4 inv0 = mul(sign_b, add(sub(mul(vec1, fac0), mul(vec2, fac1)), mul(vec3, fac2)));
+		f4 inv1 = mul(sign_a, add(sub(mul(vec0, fac0), mul(vec2, fac3)), mul(vec3, fac4)));
+		f4 inv2 = mul(sign_b, add(sub(mul(vec0, fac1), mul(vec1, fac3)), mul(vec3, fac5)));
+		f4 inv3 = mul(sign_a, add(sub(mul(vec0, fac2), mul(vec1, fac4)), mul(vec2, fac5)));
+
+		// first row of the adjugate dotted with the first column of m
+		f4 row0 = shuffle<0, 0, 0, 0>(inv0, inv1);
+		f4 row1 = shuffle<0, 0, 0, 0>(inv2, inv3);
+		f4 det = dot(in0, shuffle<0, 2, 0, 2>(row0, row1));
+
+		store(res, inv0);
+		store(res + 4, inv1);
+		store(res + 8, inv2);
+		store(res + 12, inv3);
+
+		return first(det);
+	}
+
+	// res = inverse(m), res may alias m
+	inline void mat4_inverse(const float *m, float *res)
+	{
+		float adj[16];
+		float d = mat4_adjugate(m, adj);
+		f4 rcp = div(set1(1.f), set1(d));
+		for (int col = 0; col < 4; ++col)
+			store(res + col * 4, mul(load(adj + col * 4), rcp));
+	}
+}
+
+DETAIL_END
+SGL_END
+
+#endif
@@ -1,6 +1,8 @@
 #pragma once
 #include "macro.h"
+#include "numerics.h"
 #include <cmath>
+#include <type_traits>
 
 SGL_BEG
 
@@ -69,8 +71,8 @@ struct vec<T, 1>
 	inline T *data() { return reinterpret_cast<T*>(this); }
 	inline T const *data() const { return reinterpret_cast<const T*>(this); }
 
-	inline T &operator[](vec_len i) { return data()[i]; }
-	inline T operator[](vec_len i) const { return data()[i]; }
+	constexpr T &operator[](vec_len) { return x; }
+	constexpr T operator[](vec_len) const { return x; }
 	
 	template <typename ValT>
 	constexpr vec &operator+=(vec<ValT, 1> o)
@@ -168,8 +170,34 @@ struct vec<T, 2>
 	inline T *data() { return reinterpret_cast<T*>(this); }
 	inline T const *data() const { return reinterpret_cast<const T*>(this); }
 
-	inline T &operator[](vec_len i) { return data()[i]; }
-	inline T operator[](vec_len i) const { return data()[i]; }
+	constexpr T &operator[](vec_len i)
+	{
+		if (std::is_constant_evaluated())
+		{
+			switch (i)
+			{
+			case 0:
+				return x;
+			default:
+				return y;
+			}
+		}
+		return data()[i];
+	}
+	constexpr T operator[](vec_len i) const
+	{
+		if (std::is_constant_evaluated())
+		{
+			switch (i)
+			{
+			case 0:
+				return x;
+			default:
+				return y;
+			}
+		}
+		return data()[i];
+	}
 	
 	template <typename ValT>
 	constexpr vec &operator+=(vec<ValT, 2> o)
@@ -285,8 +313,38 @@ struct vec<T, 3>
 	inline T *data() { return reinterpret_cast<T*>(this); }
 	inline T const *data() const { return reinterpret_cast<const T*>(this); }
 
-	inline T &operator[](vec_len i) { return data()[i]; }
-	inline T operator[](vec_len i) const { return data()[i]; }
+	constexpr T &operator[](vec_len i)
+	{
+		if (std::is_constant_evaluated())
+		{
+			switch (i)
+			{
+			case 0:
+				return x;
+			case 1:
+				return y;
+			default:
+				return z;
+			}
+		}
+		return data()[i];
+	}
+	constexpr T operator[](vec_len i) const
+	{
+		if (std::is_constant_evaluated())
+		{
+			switch (i)
+			{
+			case 0:
+				return x;
+			case 1:
+				return y;
+			default:
+				return z;
+			}
+		}
+		return data()[i];
+	}
 	
 	template <typename ValT>
 	constexpr vec &operator+=(vec<ValT, 3> o)
@@ -420,8 +478,42 @@ struct vec<T, 4>
 	inline T *data() { return reinterpret_cast<T*>(this); }
 	inline T const *data() const { return reinterpret_cast<const T*>(this); }
 
-	inline T &operator[](vec_len i) { return data()[i]; }
-	inline T operator[](vec_len i) const { return data()[i]; }
+	constexpr T &operator[](vec_len i)
+	{
+		if (std::is_constant_evaluated())
+		{
+			switch (i)
+			{
+			case 0:
+				return x;
+			case 1:
+				return y;
+			case 2:
+				return z;
+			default:
+				return w;
+			}
+		}
+		return data()[i];
+	}
+	constexpr T operator[](vec_len i) const
+	{
+		if (std::is_constant_evaluated())
+		{
+			switch (i)
+			{
+			case 0:
+				return x;
+			case 1:
+				return y;
+			case 2:
+				return z;
+			default:
+				return w;
+			}
+		}
+		return data()[i];
+	}
 	
 	template <typename ValT>
 	constexpr vec &operator+=(vec<ValT, 4> o)
@@ -625,7 +717,7 @@ constexpr T magnitude2(vec<T, sz> v)
 template <typename T, vec_len sz>
 constexpr T magnitude(vec<T, sz> v)
 {
-	return std::sqrt(magnitude2(v));
+	return sgl::sqrt(magnitude2(v));
 }
 
 template <typename T, vec_len sz>
@@ -3,6 +3,7 @@
 #include "object/shape_data.h"
 #include "object/render_obj.h"
 #include "object/texture.h"
+#include "math/bound.h"
 
 #include <optional>
 #include <memory>
@@ -28,7 +29,7 @@ public:
 
 	struct mesh
 	{
-		inline mesh() : material{} {}
+		inline mesh() : material{}, aabb{} {}
 
 		struct vertex_type
 		{
@@ -41,12 +42,20 @@ public:
 		std::vector<unsigned int> indices;
 		const material_type *material;
 
+		// local bounds of vertices
+		bound aabb;
+
 		vbo get_vbo() const;
 		ebo get_ebo() const;
 	};
 
 	struct node
 	{
+		inline node() : transform{identity()} {}
+
+		// relative to the parent node
+		mat4 transform;
+
 		std::vector<const mesh *> meshes;
 		std::vector<std::unique_ptr<node>> children;
 	};
@@ -91,6 +100,9 @@ public:
 
 	void draw(render_target &target, const render_settings &settings) const override;
 	void draw(render_target &target) const override;
+
+protected:
+	render_shader *default_shader() const override;
 };
 
 class model_type : public render_type
@@ -122,7 +134,21 @@ public:
 	void draw(render_target &target, const render_settings &settings) const override;
 	void draw(render_target &target) const override;
 
+	/// @brief root of the model's node hierarchy. Set its local transform to move the whole model,
+	/// or attach it to another node
+	inline scene_node &root() { return *m_nodes.front(); }
+	inline const scene_node &root() const { return *m_nodes.front(); }
+
+	// one per mesh reference in the model's node hierarchy, attached to the node that references it
 	std::vector<mesh_obj<scalable, rotatable>> meshes;
+
+protected:
+	// every mesh draws with the same default shader
+	render_shader *default_shader() const override;
+
+private:
+	// the model's node hierarchy, root first. Heap allocated so that the nodes stay put when model_obj is moved
+	std::vector<std::unique_ptr<scene_node>> m_nodes;
 };
 
 SGL_END
\ No newline at end of file
@@ -41,11 +41,12 @@ public:
 
 	inline void use() const override
 	{
-		glBindVertexArray(id);
+		detail::state().bind_vertex_array(id);
 	}
 
 	inline void destroy() override
 	{
+		detail::state().on_delete_vertex_array(id);
 		glDeleteVertexArrays(1, &id);
 		id = 0;
 	}
@@ -57,7 +58,7 @@ public:
 
 	inline static void quit()
 	{
-		glBindVertexArray(0);
+		detail::state().bind_vertex_array(0);
 	}
 
 	buffer_view<GL_ARRAY_BUFFER> get_attribute(GLuint index) const;
@@ -86,7 +87,7 @@ public:
 
 	inline void use() const
 	{
-		glBindBuffer(t, id);
+		detail::state().bind_buffer(t, id);
 	}
 
 	inline unsigned int index() const
@@ -165,7 +166,7 @@ public:
 		{
 			detail::context_lock<detail::binding<target>> lock;
 
-			glBindBuffer(target, id);
+			detail::state().bind_buffer(target, id);
 			m_data = reinterpret_cast<T *>(glMapBuffer(target, access));
 		}
 
@@ -203,7 +204,7 @@ public:
 			{
 				detail::context_lock<detail::binding<target>> lock;
 
-				glBindBuffer(target, m_id);
+				detail::state().bind_buffer(target, m_id);
 				glUnmapBuffer(target);
 			}
 
@@ -247,7 +248,7 @@ public:
 
 	inline void use() const
 	{
-		glBindRenderbuffer(target, id);
+		detail::state().bind_renderbuffer(id);
 	}
 
 	inline unsigned int index() const
@@ -264,7 +265,7 @@ public:
 
 	inline static void quit()
 	{
-		glBindRenderbuffer(target, 0);
+		detail::state().bind_renderbuffer(0);
 	}
 
 private:
@@ -292,7 +293,7 @@ public:
 
 	inline void use() const
 	{
-		glBindFramebuffer(target, id);
+		detail::state().bind_framebuffer(id);
 	}
 
 	inline unsigned int index() const
@@ -316,7 +317,7 @@ public:
 
 	inline static void quit()
 	{
-		glBindFramebuffer(target, 0);
+		detail::state().bind_framebuffer(0);
 	}
 
 private:
@@ -369,6 +370,7 @@ public:
 
 	inline void destroy() override
 	{
+		detail::state().on_delete_buffer(id.id);
 		glDeleteBuffers(1, &id.id);
 		id.id = 0;
 	}
@@ -472,6 +474,7 @@ public:
 
 	inline void destroy() override
 	{
+		detail::state().on_delete_renderbuffer(id.id);
 		glDeleteRenderbuffers(1, &id.id);
 		id.id = 0;
 	}
@@ -531,11 +534,12 @@ public:
 
 	inline void use() const override
 	{
-		glBindFramebuffer(target, id.id);
+		detail::state().bind_framebuffer(id.id);
 	}
 
 	inline void destroy() override
 	{
+		detail::state().on_delete_framebuffer(id.id);
 		glDeleteFramebuffers(1, &id.id);
 		id.id = 0;
 	}
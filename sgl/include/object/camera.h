@@ -74,6 +74,8 @@ private:
 
     inline void get_axes()
     {
+        // unit axes keep view() a pure rotation and translation
+        m_dir = normalize(m_dir);
         if (m_dir.x || m_dir.z)
             m_right = normalize(cross(sgl::vec3{0, 1, 0}, m_dir));
         else if (m_dir.y > 0)
@@ -0,0 +1,117 @@
+#pragma once
+#include "macro.h"
+#include "texture.h"
+#include "math/vec.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+SGL_BEG
+
+/// @brief single channel (GL_R8) textures that many small bitmaps, such as font glyphs, are packed into.
+/// Bitmaps are placed on shelves (rows as tall as the first bitmap placed on them), and a new page is created when a bitmap fits on no page.
+/// The number of pages can be limited, once it is reached the least recently used page can be evicted to make room
+class glyph_atlas
+{
+public:
+	static constexpr int default_page_size = 1024;
+	static constexpr std::size_t unlimited_pages = std::numeric_limits<std::size_t>::max();
+	static constexpr unsigned int no_page = std::numeric_limits<unsigned int>::max();
+
+	// location of a bitmap in the atlas
+	struct region
+	{
+		unsigned int page;
+
+		// in pixels, from the bottom left of the page
+		ivec2 pos;
+		ivec2 size;
+
+		// texture coordinates of the bottom left and top right corners of the bitmap
+		vec2 text_min;
+		vec2 text_max;
+	};
+
+	// row of bitmaps, as tall as the first bitmap placed on it
+	struct shelf
+	{
+		int y;
+		int height;
+		// first free column
+		int x;
+	};
+
+	/// @param min_filter GL_TEXTURE_MIN_FILTER of the pages, magnification is always linear
+	inline explicit glyph_atlas(int page_size = default_page_size, GLint min_filter = GL_NEAREST, std::size_t max_pages = unlimited_pages) : m_page_size{page_size}, m_max_pages{max_pages}, m_min_filter{min_filter} {}
+
+	/// @brief copy a bitmap into the atlas
+	/// @param bitmap 1 byte per pixel, rows from top to bottom
+	/// @param pitch bytes from the start of one row to the next
+	/// @param res set to where the bitmap was placed. An empty bitmap, or one larger than a page, gets an empty region on page 0
+	/// @param over_budget create a new page even if there are already max_pages
+	/// @return false if the bitmap fits on no page and no page can be created. Call evict and try again
+	bool add(const unsigned char *bitmap, int width, int height, int pitch, region &res, bool over_budget = false);
+
+	// remove every bitmap, keeping the pages
+	void clear();
+
+	/// @brief mark a page as used at time stamp, evict removes the page with the oldest stamp first
+	inline void touch(unsigned int page, std::uint64_t stamp)
+	{
+		if (m_pages[page].last_use < stamp)
+			m_pages[page].last_use = stamp;
+	}
+
+	/// @brief empty the least recently used page, every region on it becomes invalid
+	/// @param keep pages touched at or after this stamp are not evicted
+	/// @return the evicted page, or no_page if every page was touched at or after keep
+	unsigned int evict(std::uint64_t keep);
+
+	// pages created before the limit was lowered are kept
+	inline void set_max_pages(std::size_t max_pages) { m_max_pages = max_pages; }
+	inline std::size_t max_pages() const { return m_max_pages; }
+
+	/// @brief copy a page's texels into out, bottom row first. out must hold page_size() * page_size() bytes
+	void read_page(unsigned int index, unsigned char *out) const;
+
+	// packing state of a page, saved along with its texels to restore it with restore_page
+	inline const std::vector<shelf> &shelves(unsigned int index) const { return m_pages[index].shelves; }
+	inline int next_row(unsigned int index) const { return m_pages[index].next_y; }
+
+	/// @brief add a page saved with read_page, shelves and next_row. Created even if there are already max_pages
+	/// @param texels page_size() * page_size() bytes, bottom row first
+	/// @return index of the new page
+	unsigned int restore_page(const unsigned char *texels, std::vector<shelf> shelves, int next_y);
+
+	inline const texture &page(unsigned int index) const { return m_pages[index].text; }
+	inline std::size_t page_count() const { return m_pages.size(); }
+	inline int page_size() const { return m_page_size; }
+
+private:
+	struct page_data
+	{
+		texture text;
+		std::vector<shelf> shelves;
+		// first row without a shelf
+		int next_y;
+		std::uint64_t last_use;
+	};
+
+	std::vector<page_data> m_pages;
+	int m_page_size;
+	std::size_t m_max_pages;
+	GLint m_min_filter;
+
+	// space left between bitmaps so linear filtering doesn't sample neighbours
+	static constexpr int padding = 1;
+
+	bool place(page_data &p, int width, int height, ivec2 &pos);
+	// texels to fill the page with, or nullptr for an empty page
+	page_data &add_page(const unsigned char *texels = nullptr);
+	// zero the page's texels, so padding around new bitmaps is empty
+	void clear_texels(page_data &p);
+};
+
+SGL_END
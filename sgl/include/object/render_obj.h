@@ -1,7 +1,9 @@
 #pragma once
 #include "macro.h"
 #include "math/mat.h"
+#include "math/quat.h"
 #include "buffers.h"
+#include "scene.h"
 
 SGL_BEG
 
@@ -79,6 +81,15 @@ protected:
 	// call before drawing operations
 	void bind_target(render_target &target) const;
 
+	// shader drawn with when render_settings::shader is nullptr, nullptr if it is unknown before drawing
+	virtual render_shader *default_shader() const { return nullptr; }
+
+	// shader a draw with settings binds
+	inline render_shader *get_shader(const render_settings &settings) const
+	{
+		return settings.shader ? settings.shader : default_shader();
+	}
+
 	inline const vao *get_vao() const
 	{
 		const rendervao_type *vao_type = dynamic_cast<const rendervao_type *>(type);
@@ -88,6 +99,8 @@ protected:
 	}
 
 	const render_type *type;
+
+	friend render_target;
 };
 
 //class render_settings_obj : public render_obj
@@ -109,17 +122,32 @@ template<>
 class transformable_obj<false, false, false> : public virtual render_obj
 {
 public:
-	inline transformable_obj() : render_obj(), model{ identity() }, changed{ true } {}
-	inline transformable_obj(const render_type &rtype) : render_obj(rtype), model{ identity() }, changed{ true } {}
+	inline transformable_obj() : render_obj(), model{ identity() }, m_parent{}, m_parent_version{}, changed{ true } {}
+	inline transformable_obj(const render_type &rtype) : render_obj(rtype), model{ identity() }, m_parent{}, m_parent_version{}, changed{ true } {}
 
+	// model includes the world transform of the parent node, if there is one
 	inline const mat4 &get_model() const { return model; }
 
+	/// @brief attach to a node of a transform hierarchy, the object's transforms become relative to it
+	/// @param parent node to attach to, nullptr to detach. Must outlive the object or be detached first
+	inline void set_parent(const scene_node *parent) { m_parent = parent; changed = true; }
+	inline const scene_node *get_parent() const { return m_parent; }
+
 	// call before draw operations
 	inline void update_model() const
 	{
+		if (m_parent && m_parent->version() != m_parent_version)
+			changed = true;
+
 		if (changed)
 		{
-			model = identity();
+			if (m_parent)
+			{
+				model = m_parent->get_world();
+				m_parent_version = m_parent->version();
+			}
+			else
+				model = identity();
 			apply_transform();
 			changed = false;
 		}
@@ -138,6 +166,9 @@ protected:
 	virtual void apply_transform() const = 0;
 
 private:
+	const scene_node *m_parent;
+	mutable std::uint64_t m_parent_version;
+
 	// mutable is neccessary because it may need to be updated when draw is called
 	mutable bool changed;
 };
@@ -195,19 +226,33 @@ template <>
 class transformable_obj<false, false, true> : public virtual transformable_obj<false, false, false>
 {
 public:
-	inline transformable_obj() : m_origin{}, m_axis{0, 0, 1}, m_angle{} {}
-	inline transformable_obj(vec3 origin, vec3 axis, float angle) : m_origin{origin}, m_axis{normalize(axis)}, m_angle{angle} {}
+	inline transformable_obj() : m_origin{}, m_rotation{}, m_axis{0, 0, 1}, m_angle{} {}
+	inline transformable_obj(vec3 origin, vec3 axis, float angle) : m_origin{origin}, m_rotation{angle_axis(angle, axis)}, m_axis{normalize(axis)}, m_angle{angle} {}
+	inline transformable_obj(vec3 origin, quat rotation) : m_origin{origin} { set_rotation(rotation); }
 
 	// rot_origin is local to the object, not the world
 	inline void set_rot_origin(vec3 origin) { m_origin = origin; data_changed(); }
 	inline vec3 get_rot_origin() const { return m_origin; }
 
-	inline void set_rot_axis(vec3 axis) { m_axis = normalize(axis); data_changed(); }
+	inline void set_rot_axis(vec3 axis) { m_axis = normalize(axis); m_rotation = angle_axis(m_angle, m_axis); data_changed(); }
 	inline vec3 get_rot_axis() const { return m_axis; }
 
-	inline void set_angle(float angle) { m_angle = angle; data_changed(); }
+	inline void set_angle(float angle) { m_angle = angle; m_rotation = angle_axis(m_angle, m_axis); data_changed(); }
 	inline float get_angle() const { return m_angle; }
 
+	// orientation as a unit quaternion, axis and angle are derived from it
+	inline void set_rotation(quat rotation)
+	{
+		m_rotation = normalize(rotation);
+		m_axis = axis(m_rotation);
+		m_angle = angle(m_rotation);
+		data_changed();
+	}
+	inline quat get_rotation() const { return m_rotation; }
+
+	// applies rotation after the current orientation
+	inline void rotate(quat rotation) { set_rotation(rotation * m_rotation); }
+
 	virtual ~transformable_obj() = default;
 
 	static constexpr bool is_movable = false;
@@ -215,6 +260,9 @@ public:
 	static constexpr bool is_rotatable = true;
 protected:
 	vec3 m_origin;
+	quat m_rotation;
+
+	// kept alongside m_rotation so set_angle(get_angle() + x) keeps its axis and direction
 	vec3 m_axis;
 	float m_angle;
 
@@ -1,7 +1,13 @@
 #pragma once
 #include "math/mat.h"
+#include "math/frustum.h"
 #include "buffers.h"
 #include "texture.h"
+#include "render_obj.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 SGL_BEG
 
@@ -16,7 +22,7 @@ struct viewport
 
 	inline void apply() const
 	{
-		glViewport(pos.x, pos.y, size.x, size.y);
+		detail::state().set_viewport({pos.x, pos.y, size.x, size.y});
 	}
 };
 
@@ -35,6 +41,17 @@ void set_view(const mat4 *view);
 /// @return pointer to view matrix
 const mat4 *get_view();
 
+/// @brief get frustum of the current projection and view, in world space
+/// @return frustum, recomputed only when the projection or view has changed since the last call
+const frustum &get_frustum();
+
+/// @brief enable or disable skipping the draws of objects that are fully outside the view frustum. Enabled by default.
+/// Disable if a vertex shader moves vertices outside of the object's bounds
+void set_frustum_culling(bool enabled);
+
+/// @return whether frustum culling is enabled
+bool get_frustum_culling();
+
 class render_target
 {
 public:
@@ -43,6 +60,21 @@ public:
 	void draw(const render_obj &obj, const render_settings &settings);
 	void draw(const render_obj &obj);
 
+	/// @brief queue a draw to be executed by flush instead of drawing immediately.
+	/// Queued draws are sorted by pass, then opaque before blended, then by shader, material and vao to minimize state changes.
+	/// Opaque draws are drawn front to back and blended draws back to front
+	/// @param obj object to draw. Must be alive until flush is called
+	/// @param blended true if obj should be drawn with alpha blending (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)
+	/// @param pass draws of lower passes are drawn first, regardless of the other sort criteria. Must be less than 16, other draws are logged and dropped
+	void submit(const render_obj &obj, const render_settings &settings, bool blended = false, unsigned int pass = 0);
+	void submit(const render_obj &obj);
+
+	/// @brief draw and remove every queued draw
+	void flush();
+
+	/// @return number of queued draws
+	inline std::size_t queued() const { return m_queue.size(); }
+
 	inline void set_viewport(viewport view)
 	{
 		this->view = view;
@@ -68,6 +100,20 @@ public:
 protected:
 	viewport view;
 
+	struct queued_draw
+	{
+		const render_obj *obj;
+		render_settings settings;
+		unsigned int pass;
+		bool blended;
+	};
+
+	std::vector<queued_draw> m_queue;
+
+	// (sort key, index into m_queue), and scratch space for sorting them
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> m_keys;
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> m_sort_buffer;
+
 	friend render_obj;
 	friend render_type;
 
@@ -0,0 +1,67 @@
+#pragma once
+#include "macro.h"
+#include "math/mat.h"
+
+#include <cstdint>
+#include <vector>
+
+SGL_BEG
+
+/// @brief node of a transform hierarchy. Each node has a local transform relative to its parent,
+/// and a cached world transform that is only recomputed when it or one of its ancestors has changed.
+/// Nodes don't own their children, and detach themselves from parent and children when destroyed
+class scene_node
+{
+public:
+	scene_node(const scene_node &) = delete;
+	scene_node &operator=(const scene_node &) = delete;
+
+	inline scene_node() : m_local{identity()}, m_world{identity()}, m_parent{}, m_version{}, m_dirty{true} {}
+	inline explicit scene_node(const mat4 &local) : m_local{local}, m_world{local}, m_parent{}, m_version{}, m_dirty{true} {}
+
+	~scene_node();
+
+	inline void set_local(const mat4 &local) { m_local = local; mark_dirty(); }
+	inline const mat4 &get_local() const { return m_local; }
+
+	/// @brief get world transform (parent world * local)
+	/// @return cached world transform, recomputed first if this node or an ancestor changed
+	inline const mat4 &get_world() const
+	{
+		if (m_dirty)
+			recompute();
+		return m_world;
+	}
+
+	/// @brief attach child to this node, detaching it from its previous parent
+	void attach(scene_node &child);
+
+	/// @brief detach from parent, the node becomes a root
+	void detach();
+
+	inline scene_node *get_parent() const { return m_parent; }
+	inline const std::vector<scene_node *> &children() const { return m_children; }
+
+	/// @brief incremented every time the world transform is recomputed. Used by dependents to know when to update
+	inline std::uint64_t version() const { get_world(); return m_version; }
+
+	/// @brief recompute the world transforms of every changed node in this subtree
+	void update() const;
+
+private:
+	mat4 m_local;
+	mutable mat4 m_world;
+
+	scene_node *m_parent;
+	std::vector<scene_node *> m_children;
+
+	mutable std::uint64_t m_version;
+
+	// if a node is dirty, all of its descendants are dirty too
+	mutable bool m_dirty;
+
+	void mark_dirty();
+	void recompute() const;
+};
+
+SGL_END
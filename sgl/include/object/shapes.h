@@ -4,6 +4,8 @@
 #include "math/bound.h"
 #include "shape_data.h"
 
+#include <vector>
+
 SGL_BEG
 
 template <bool rotatable = false>
@@ -18,6 +20,9 @@ public:
 
 	void draw(render_target& target) const override;
 	void draw(render_target &target, const render_settings &settings) const override;
+
+protected:
+	render_shader *default_shader() const override;
 };
 
 template <bool rotatable = false>
@@ -49,7 +54,10 @@ protected:
 	vec3 m_up;
 	vec2 m_sz;
 
-	void setup_buffer() const;
+	// model with the unit quad scaled onto right and up, call after update_model
+	mat4 quad_model() const;
+
+	render_shader *default_shader() const override;
 };
 
 template <vec_len dim>
@@ -74,6 +82,7 @@ protected:
 	float m_size;
 
 	void apply_transform() const override;
+	render_shader *default_shader() const override;
 };
 
 template <bool scalable = false, bool rotatable = false>
@@ -96,11 +105,67 @@ public:
 
 protected:
 	void apply_transform() const override;
+	render_shader *default_shader() const override;
 
 	vec3 m_end;
 	float m_width;
 };
 
+/// @brief draws many objects that share the cube geometry (cube_obj, point_obj<3>, line_obj) with a single instanced draw call.
+/// Objects are captured by their model matrix when added, so clear and add them again after they change
+class cube_batch : public render_obj
+{
+public:
+	cube_batch();
+
+	template <bool rotatable>
+	inline void add(const cube_obj<rotatable> &obj, vec4 color = {0, 0, 0, 1}) { add_obj(obj, color); }
+	inline void add(const point_obj<3> &obj, vec4 color = {0, 0, 0, 1}) { add_obj(obj, color); }
+	template <bool scalable, bool rotatable>
+	inline void add(const line_obj<scalable, rotatable> &obj, vec4 color = {0, 0, 0, 1}) { add_obj(obj, color); }
+
+	/// @brief add an instance directly
+	/// @param model transform of a unit cube centered on the origin
+	inline void add(const mat4 &model, vec4 color = {0, 0, 0, 1}) { m_instances.push_back({model, color}); m_changed = true; }
+
+	inline void clear() { m_instances.clear(); m_changed = true; }
+	inline void reserve(std::size_t count) { m_instances.reserve(count); }
+	inline std::size_t size() const { return m_instances.size(); }
+
+	/// @brief draw every instance. settings.color is ignored in favor of the instance colors
+	/// @param settings a custom shader must include variables::sgl_InstanceModel, and variables::sgl_InstanceColor to read the colors.
+	/// sgl_ModelViewProj, sgl_ModelView and sgl_Model don't include the instance transform, multiply by sgl_InstanceModel
+	void draw(render_target &target, const render_settings &settings) const override;
+	void draw(render_target &target) const override;
+
+protected:
+	render_shader *default_shader() const override;
+
+private:
+	struct instance
+	{
+		mat4 model;
+		vec4 color;
+	};
+
+	std::vector<instance> m_instances;
+
+	vao m_vao;
+	vbo m_buffer;
+
+	// number of instances m_buffer has storage for
+	mutable std::size_t m_capacity;
+	mutable bool m_changed;
+
+	inline void add_obj(const base_transformable_obj &obj, vec4 color)
+	{
+		obj.update_model();
+		add(obj.get_model(), color);
+	}
+
+	void upload() const;
+};
+
 // class polygon_obj : public movable_obj, public rotatable_obj, public colorable_obj
 // {
 // public:
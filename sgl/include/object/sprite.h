@@ -2,6 +2,8 @@
 #include "shapes.h"
 #include "texture.h"
 
+#include <vector>
+
 SGL_BEG
 
 template <bool rotatable = false>
@@ -30,8 +32,81 @@ public:
 
 	void draw(render_target &target) const override;
 	void draw(render_target &target, const render_settings &settings) const override;
+protected:
+	render_shader *default_shader() const override;
 private:
 	const texture* m_texture;
 };
 
+/// @brief draws many textured quads with one indexed draw call per texture.
+/// Quads are transformed on the cpu when added, so clear and add them again after they change
+class sprite_batch : public render_obj
+{
+public:
+	sprite_batch();
+
+	template <bool rotatable>
+	inline void add(const sprite<rotatable> &obj)
+	{
+		obj.update_model();
+		add(obj.get_texture(), obj.get_model(), obj.get_size().x * obj.get_right(), obj.get_size().y * obj.get_up());
+	}
+
+	/// @brief add a quad directly
+	/// @param model transform applied to the quad
+	/// @param right edge of the quad corresponding to the x axis of the texture
+	/// @param up edge of the quad corresponding to the y axis of the texture
+	/// @param text_min minimum texture coordinate, used to draw part of a texture (i.e. a sprite sheet)
+	/// @param text_max maximum texture coordinate
+	void add(const texture &texture, const mat4 &model, vec3 right, vec3 up, vec2 text_min = {0, 0}, vec2 text_max = {1, 1});
+
+	inline void clear() { m_quads.clear(); m_changed = true; }
+	inline void reserve(std::size_t count) { m_quads.reserve(count); }
+	inline std::size_t size() const { return m_quads.size(); }
+
+	void draw(render_target &target, const render_settings &settings) const override;
+	void draw(render_target &target) const override;
+
+protected:
+	render_shader *default_shader() const override;
+
+private:
+	struct vertex
+	{
+		vec3 pos;
+		vec2 text_pos;
+	};
+
+	struct quad
+	{
+		const texture *text;
+		vertex vertices[4];
+	};
+
+	// consecutive quads with the same texture after sorting
+	struct range
+	{
+		const texture *text;
+		std::size_t first;
+		std::size_t count;
+	};
+
+	std::vector<quad> m_quads;
+
+	vao m_vao;
+
+	vbo m_vertices;
+	ebo m_indices;
+
+	mutable std::vector<range> m_ranges;
+	mutable std::vector<std::size_t> m_order;
+	mutable std::vector<vertex> m_staging;
+
+	// number of quads m_indices has indices for
+	mutable std::size_t m_index_capacity;
+	mutable bool m_changed;
+
+	void upload() const;
+};
+
 SGL_END
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include "buffers.h"
+
+#include <vector>
+
+SGL_BEG
+
+/// @brief ring buffer for vertex data that is rewritten every draw.
+/// If buffer storage is supported (GL 4.4 or ARB_buffer_storage), the buffer is persistently mapped once.
+/// The ring is split into regions, and a region is only written again after a fence shows the gpu has finished the draws that read it.
+/// Otherwise each allocation is mapped unsynchronized, and the buffer is orphaned when the ring wraps
+class stream_buffer
+{
+public:
+	stream_buffer(const stream_buffer &) = delete;
+	stream_buffer &operator=(const stream_buffer &) = delete;
+
+	/// @param size size of the ring in bytes
+	/// @param regions number of regions the ring is split into, allocations can't be larger than a region
+	explicit stream_buffer(GLsizeiptr size, unsigned int regions = 3);
+	~stream_buffer();
+
+	/// @brief reserve space for count elements of T
+	/// @param first set to the index of the first element, in units of T from the start of the buffer (i.e. the first vertex to draw)
+	/// @return pointer to write the elements to, valid until commit. nullptr if count elements don't fit in a region
+	template <typename T>
+	inline T *allocate(std::size_t count, GLint &first)
+	{
+		GLintptr offset;
+		void *res = allocate_bytes(static_cast<GLsizeiptr>(count * sizeof(T)), sizeof(T), offset);
+		first = static_cast<GLint>(offset / static_cast<GLintptr>(sizeof(T)));
+		return static_cast<T *>(res);
+	}
+
+	/// @brief make the last allocation visible to GL, call after writing and before drawing
+	void commit();
+
+	inline const vbo &buffer() const { return m_buffer; }
+	inline bool persistent() const { return m_persistent; }
+
+private:
+	vbo m_buffer;
+
+	GLsizeiptr m_size;
+	GLsizeiptr m_region_size;
+	GLintptr m_offset;
+
+	unsigned int m_region;
+	// fence of each region, placed when the ring moves past the region
+	std::vector<GLsync> m_fences;
+
+	// start of the persistent mapping
+	unsigned char *m_mapped;
+	bool m_persistent;
+	// true if the unsynchronized mapping of the fallback needs to be unmapped
+	bool m_needs_unmap;
+
+	void *allocate_bytes(GLsizeiptr size, GLsizeiptr alignment, GLintptr &offset);
+
+	void enter_region(unsigned int region);
+};
+
+SGL_END
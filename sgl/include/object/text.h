@@ -3,9 +3,20 @@
 #include "math/vec.h"
 #include "math/bound.h"
 #include "texture.h"
+#include "glyph_atlas.h"
+#include "utils/unicode.h"
 
 #include <string>
-#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <array>
+#include <bitset>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <optional>
 
 struct FT_FaceRec_;
 
@@ -13,6 +24,15 @@ SGL_BEG
 
 DETAIL_BEG
 struct library_handle;
+struct glyph_bitmap;
+class glyph_rasterizer;
+
+// vertex of a glyph quad
+struct glyph_vertex
+{
+	vec3 pos;
+	vec2 text_pos;
+};
 DETAIL_END
 
 class font
@@ -20,21 +40,80 @@ class font
 public:
 	static constexpr unsigned int default_height = 48;
 
-	font() = default;
+	// how glyphs are rasterized
+	enum class glyph_mode
+	{
+		// coverage at the font's pixel height, blurry or blocky when scaled far from it
+		bitmap,
+		// signed distance to the outline, stays sharp at any scale or orientation
+		sdf,
+	};
+
+	// worker threads that rasterize glyphs of each font, see set_worker_count
+	static constexpr unsigned int default_worker_count = 2;
 
-	inline font(const std::string &file_name, unsigned int height) : font()
+	font();
+	~font();
+
+	font(font &&other) noexcept;
+	font &operator=(font &&other) noexcept;
+
+	inline font(const std::string &file_name, unsigned int height, glyph_mode mode = glyph_mode::bitmap) : font()
 	{
-		load(file_name, height);
+		load(file_name, height, mode);
 	}
-	inline font(const void *data, std::size_t size, unsigned int height) : font()
+	inline font(const void *data, std::size_t size, unsigned int height, glyph_mode mode = glyph_mode::bitmap) : font()
 	{
-		load(data, size, height);
+		load(data, size, height, mode);
 	}
 
-	void load(const std::string &file_name, unsigned int height);
-	void load(const void *data, std::size_t size, unsigned int height);
+	/// @param height pixel height glyphs are rasterized at. For glyph_mode::sdf this only sets the detail of the distance field, 32 to 64 is usually enough
+	void load(const std::string &file_name, unsigned int height, glyph_mode mode = glyph_mode::bitmap);
+	void load(const void *data, std::size_t size, unsigned int height, glyph_mode mode = glyph_mode::bitmap);
 
 	inline unsigned int get_character_height() const { return face.size; }
+	inline glyph_mode get_mode() const { return m_mode; }
+
+	// distance between the baselines of two lines, in pixels
+	inline int get_line_height() const { return m_line_height; }
+	// distance from the baseline up to the top of the highest glyph, in pixels
+	inline int get_ascender() const { return m_ascender; }
+	// distance from the baseline to the bottom of the lowest glyph, in pixels. Negative when below the baseline
+	inline int get_descender() const { return m_descender; }
+
+	/// @brief limit the memory used by glyph bitmaps. When it is used up, the atlas page whose glyphs were used the longest ago is reused,
+	/// and texts using the font lay out again. Pages holding glyphs of the text being laid out are never reused, so the budget can be exceeded by one text
+	/// @param bytes rounded down to whole atlas pages, at least one page is always kept
+	void set_cache_budget(std::size_t bytes);
+	inline std::size_t get_cache_budget() const { return m_budget; }
+
+	static constexpr std::size_t unlimited_budget = std::numeric_limits<std::size_t>::max();
+
+	/// @brief set how many threads rasterize glyphs. With workers, a text drawing a glyph that isn't loaded yet requests it and leaves a gap
+	/// until it is ready, instead of waiting for FreeType. Measuring a text (text::get_local_rect, text::get_local_bound) still waits for its glyphs
+	/// @param count 0 to rasterize on the calling thread when a glyph is first used
+	void set_worker_count(unsigned int count);
+	inline unsigned int get_worker_count() const { return m_worker_count; }
+
+	/// @brief rasterize and upload the glyphs of codepoints first to last (inclusive) ahead of time, i.e. during startup
+	/// @param wait block until they are in the atlas, otherwise they are uploaded by later draws
+	void prewarm(uint32_t first, uint32_t last, bool wait = true);
+
+	/// @brief write every loaded glyph's bitmap and metrics, as packed in the atlas, to file_name, so load_cache can skip FreeType in a later run.
+	/// Glyphs still being rasterized by workers are waited for first
+	/// @return false if the file couldn't be written
+	bool save_cache(const std::string &file_name) const;
+
+	/// @brief replace the loaded glyphs with the ones in a file written by save_cache, uploading its atlas pages as they are.
+	/// The cache is only used if it was saved from a font with the same file contents, height and glyph_mode
+	/// @return false if the file doesn't exist or doesn't match the font, the font is unchanged then
+	bool load_cache(const std::string &file_name);
+
+	// incremented every time the font is loaded, so texts know their cached layouts are out of date
+	inline std::uint64_t version() const { return m_version; }
+
+	// incremented every time glyph metrics can change (when the font is loaded), unlike version which also changes when glyphs are evicted
+	inline std::uint64_t metrics_version() const { return m_metrics_version; }
 
 private:
 	friend class text;
@@ -60,42 +139,137 @@ private:
 
 	struct character
 	{
-		inline character() noexcept : text{}, offset{}, advance{}, height{} {}
-
-		character(const font *_font, uint32_t c);
-		~character() = default;
-
-		// dummy functions to enable use with std::map
-		character(const character &other);
-		character &operator=(const character &other);
-
-		character(character &&other) noexcept;
-		character &operator=(character &&other) noexcept;
-
-		void load(const font *_font, uint32_t c);
+		inline character() noexcept : region{}, offset{}, advance{}, height{}, pending{} {}
 
-		texture text;
+		// where the glyph's bitmap is in m_atlas, region.size is the size of the bitmap
+		glyph_atlas::region region;
 
 		ivec2 offset;
 		unsigned int advance;
 
 		unsigned int height;
+
+		// true for the empty placeholder returned while a worker rasterizes the glyph
+		bool pending;
 	};
 
-	inline character const *at(uint32_t c) const
+	// codepoints below this (ASCII and Latin-1) are looked up in a flat table instead of m_chars
+	static constexpr uint32_t flat_count = 256;
+
+	/// @param wait rasterize the glyph now if it isn't loaded, instead of returning a pending placeholder
+	inline character const *at(uint32_t c, bool wait = false) const
 	{
-		if (!m_chars.count(c))
-			return &m_chars.emplace(c, character{this, c}).first->second;
-		return &m_chars.at(c);
+		const character *res = find(c);
+		if (!res)
+			res = load_character(c, wait);
+
+		if (res->region.size.x)
+			m_atlas.touch(res->region.page, m_clock);
+		return res;
 	}
 
+	inline character const *find(uint32_t c) const
+	{
+		if (c < flat_count)
+			return m_flat_loaded[c] ? &m_flat[c] : nullptr;
+
+		auto it = m_chars.find(c);
+		return it == m_chars.end() ? nullptr : &it->second;
+	}
+
+	// rasterize c now, or request it from the workers and return a pending placeholder
+	character const *load_character(uint32_t c, bool wait) const;
+
+	// copy a rasterized glyph into the atlas and the lookup tables
+	character const *store(const detail::glyph_bitmap &glyph) const;
+
+	// store glyphs the workers have finished
+	void poll() const;
+
+	// incremented every time poll stores glyphs, so texts with pending glyphs know to lay them out again
+	inline std::uint64_t arrivals() const { return m_arrivals; }
+
+	inline const texture &page(unsigned int index) const { return m_atlas.page(index); }
+
+	// glyph bitmaps of every loaded character
+	mutable glyph_atlas m_atlas;
+
+	mutable std::uint64_t m_version = 0;
+	std::uint64_t m_metrics_version = 0;
+	int m_line_height = 0;
+	int m_ascender = 0;
+	int m_descender = 0;
+	glyph_mode m_mode = glyph_mode::bitmap;
+	std::size_t m_budget = unlimited_budget;
+
+	// incremented when a text starts laying out, pages touched since then (glyphs looked up or already laid out by that text) can't be evicted.
+	// Drawing a text touches its pages too, so pages are evicted in the order they were last used
+	mutable std::uint64_t m_clock = 1;
+
+	// where face was loaded from, to open the same face on worker threads
+	std::string m_file_name;
+	const void *m_data = nullptr;
+	std::size_t m_data_size = 0;
+
+	unsigned int m_worker_count = default_worker_count;
+	std::unique_ptr<detail::glyph_rasterizer> m_rasterizer;
+	// glyphs requested from m_rasterizer that haven't been stored yet
+	mutable std::unordered_set<uint32_t> m_requested;
+	mutable std::uint64_t m_arrivals = 0;
+
+	void reset(unsigned int height, glyph_mode mode);
+	// forget every glyph and start from an empty atlas
+	void clear_glyphs();
+	// hash of the font file's contents, identifying the font in save_cache files
+	std::uint64_t source_hash() const;
+	void start_workers();
+	// read line metrics of face at its current size
+	void load_metrics();
+
+	// pixels each glyph bitmap extends past the glyph's outline on every side, the distance field's spread in sdf mode
+	int glyph_padding() const;
+
+	// copy a rendered glyph into the atlas, evicting the least recently used page if the budget is used up
+	void place_glyph(const unsigned char *bitmap, int width, int height, int pitch, glyph_atlas::region &res) const;
+
 	// mutable to allow potential addition of new characters in draw function
-	mutable std::map<uint32_t, character> m_chars;
+	mutable std::array<character, flat_count> m_flat;
+	mutable std::bitset<flat_count> m_flat_loaded;
+	mutable std::unordered_map<uint32_t, character> m_chars;
 };
 
 class text : public render_obj
 {
 public:
+	// where paragraph lines are broken when they get wider than paragraph_layout::max_width
+	enum class wrap_mode
+	{
+		// only at newlines
+		none,
+		// between words, a word wider than max_width is broken between characters
+		word,
+		// between any two characters
+		character,
+	};
+
+	enum class alignment
+	{
+		left,
+		center,
+		right,
+	};
+
+	struct paragraph_layout
+	{
+		// width of the paragraph in local units (scaled like get_local_rect). With 0 lines aren't wrapped,
+		// and are aligned on the origin instead of within the width
+		float max_width = 0;
+		wrap_mode wrap = wrap_mode::word;
+		alignment align = alignment::left;
+		// multiplier of the font's line height
+		float line_spacing = 1;
+	};
+
 	inline text() : render_obj(),
 					m_origin{},
 					m_dir{1, 0, 0},
@@ -129,8 +303,9 @@ public:
 																 m_axis{0, 0, 1},
 																 m_font{&_font},
 																 m_angle{},
-																 m_data{txt.begin(), txt.end()}
+																 m_data{}
 	{
+		append_utf8(txt);
 	}
 
 	inline text(std::basic_string_view<wchar_t> txt, font &_font) : render_obj(),
@@ -142,8 +317,9 @@ public:
 																	m_axis{0, 0, 1},
 																	m_font{ &_font },
 																	m_angle{},
-																	m_data{txt.begin(), txt.end()}
+																	m_data{}
 	{
+		append_wide(m_data, {txt.data(), txt.size()});
 	}
 
 	inline text(std::basic_string_view<uint32_t> txt, font &_font) : render_obj(),
@@ -159,19 +335,26 @@ public:
 	{
 	}
 
+	// txt is utf-8
 	inline void set_string(std::basic_string_view<char> txt)
 	{
-		m_data.assign(txt.begin(), txt.end());
+		m_data.clear();
+		append_utf8(txt);
+		invalidate(0);
 	}
 
+	// txt is utf-16 where wchar_t is 2 bytes, utf-32 otherwise
 	inline void set_string(std::basic_string_view<wchar_t> txt)
 	{
-		m_data.assign(txt.begin(), txt.end());
+		m_data.clear();
+		append_wide(m_data, {txt.data(), txt.size()});
+		invalidate(0);
 	}
 
 	inline void set_string(std::basic_string_view<uint32_t> txt)
 	{
 		m_data.assign(txt.begin(), txt.end());
+		invalidate(0);
 	}
 
 	inline const std::basic_string<uint32_t> &get_string() const
@@ -182,58 +365,96 @@ public:
 	inline void clear()
 	{
 		m_data.clear();
+		invalidate(0);
 	}
 
 	template <typename... Ts>
 	inline void insert(Ts &&...args)
 	{
+		std::size_t pos = first_index(args...);
+		std::size_t size = m_data.size();
 		m_data.insert(std::forward<Ts>(args)...);
+
+		// characters after the inserted ones are unchanged, only shifted
+		std::size_t count = m_data.size() - size;
+		invalidate(pos, pos + count, static_cast<std::ptrdiff_t>(count));
 	}
 
 	template <typename... Ts>
 	inline void erase(Ts &&...args)
 	{
+		std::size_t pos = first_index(args...);
+		std::size_t size = m_data.size();
 		m_data.erase(std::forward<Ts>(args)...);
+
+		invalidate(pos, pos, -static_cast<std::ptrdiff_t>(size - m_data.size()));
 	}
 
 	inline void push_back(uint32_t c)
 	{
+		// appending keeps the layout of the existing characters
 		m_data.push_back(c);
+		appended(m_data.size() - 1);
 	}
 
 	inline void pop_back()
 	{
 		m_data.pop_back();
+		invalidate(m_data.size());
 	}
 
 	template <typename... Ts>
 	inline void append(Ts &&...args)
 	{
+		std::size_t size = m_data.size();
 		m_data.append(std::forward<Ts>(args)...);
+		appended(size);
+	}
+
+	/// @brief decode utf-8 onto the end of the string, keeping the layout of the existing characters.
+	/// Only reallocates if the string's capacity can't hold txt.size() more characters, so reserve to append every frame without allocating
+	inline void append_utf8(std::basic_string_view<char> txt)
+	{
+		std::size_t size = m_data.size();
+		sgl::append_utf8(m_data, {txt.data(), txt.size()});
+		appended(size);
 	}
 
+	inline void reserve(std::size_t size) { m_data.reserve(size); }
+
 	template <typename... Ts>
 	inline void replace(Ts &&...args)
 	{
+		std::size_t pos = first_index(args...);
 		m_data.replace(std::forward<Ts>(args)...);
+		invalidate(pos);
 	}
 
 	template <typename... Ts>
 	inline void resize(Ts... args)
 	{
+		std::size_t pos = first_index(args...);
 		m_data.resize(args...);
+		invalidate(pos);
 	}
 
-	inline void set_text_origin(vec3 origin) { m_origin = origin; }
+	inline void set_text_origin(vec3 origin) { m_origin = origin; invalidate_vertices(); }
 	inline vec3 get_text_origin() const { return m_origin; }
 
-	inline void set_dir(vec3 dir) { m_dir = normalize(dir); }
+	inline void set_dir(vec3 dir) { m_dir = normalize(dir); invalidate_vertices(); }
 	inline vec3 get_dir() const { return m_dir; }
 
-	inline void set_up(vec3 up) { m_up = normalize(up); }
+	inline void set_up(vec3 up) { m_up = normalize(up); invalidate_vertices(); }
 	inline vec3 get_up() const { return m_up; }
 
-	inline void set_scale(vec2 scale) { m_scale = scale; }
+	// paragraph lines are wrapped again if the horizontal scale changes, max_width is in scaled units
+	inline void set_scale(vec2 scale)
+	{
+		if (m_paragraph && scale.x != m_scale.x)
+			invalidate(0);
+		m_scale = scale;
+		invalidate_vertices();
+	}
 	inline vec2 get_scale() const { return m_scale; }
 
 	// rot_origin is local to the object, not the world
@@ -246,9 +467,31 @@ public:
 	inline void set_angle(float angle) { m_angle = angle; }
 	inline float get_angle() const { return m_angle; }
 
-	inline void set_font(font& _font) noexcept { m_font = &_font; }
+	inline void set_font(font& _font) noexcept { m_font = &_font; invalidate(0); }
 	inline font const* get_font() const noexcept { return m_font;  }
 
+	/// @brief lay the text out as a paragraph: lines start at newlines, are wrapped to layout.max_width and go down along -up from the origin,
+	/// which is on the first line's baseline. Line breaks are cached, so editing the text only wraps the lines around the edit again
+	void set_paragraph(const paragraph_layout &layout);
+	// back to laying out one line along dir, the default
+	void set_single_line();
+	inline const std::optional<paragraph_layout> &get_paragraph() const { return m_paragraph; }
+
+	/// @brief only lay out and draw the paragraph lines in a region, so a scrolling view of a long text costs as much as the lines it shows.
+	/// Lines aren't moved, move the text to scroll
+	/// @param top distance down from the top of the first line, in local units
+	/// @param height 0 to draw every line
+	inline void set_visible_region(float top, float height)
+	{
+		m_view_top = top;
+		m_view_height = height;
+	}
+	inline float get_visible_top() const { return m_view_top; }
+	inline float get_visible_height() const { return m_view_height; }
+
+	// number of lines of the paragraph, wrapping all of it. 1 without a paragraph layout
+	std::size_t get_line_count() const;
+
 	/// @brief get's rect with local bounds of the text with the origin as (0,0). The minimum of the returned rect is not neccessarily (0,0). This function doesn't take into account direction
 	/// @return rect including the min of the text bounds, and the dimensions
 	rect get_local_rect() const;
@@ -260,6 +503,9 @@ public:
 	void draw(render_target &target, const render_settings &settings) const override;
 	void draw(render_target &target) const override;
 
+protected:
+	render_shader *default_shader() const override;
+
 private:
 	std::basic_string<uint32_t> m_data;
 	vec3 m_origin;
@@ -270,5 +516,120 @@ private:
 	vec2 m_scale;
 	font* m_font;
 	float m_angle;
+
+	// position of a character in font pixels, along dir and up from the origin before scaling
+	struct glyph_layout
+	{
+		// pen position before the character
+		float pen;
+		float advance;
+
+		// bottom left of the glyph's quad
+		vec2 min;
+		glyph_atlas::region region;
+	};
+
+	// layout of the first m_layout.size() characters, mutations only truncate it to the first changed character
+	mutable std::vector<glyph_layout> m_layout;
+	mutable std::uint64_t m_font_version = 0;
+
+	static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+	// first character laid out or wrapped with a glyph a worker hasn't finished yet, or npos
+	mutable std::size_t m_first_pending = npos;
+	// m_font->arrivals() when the layout was last updated
+	mutable std::uint64_t m_font_arrivals = 0;
+
+	// bounds of the first m_bounds_count characters of m_layout
+	mutable std::size_t m_bounds_count = 0;
+	mutable float m_min_y = 0;
+	mutable float m_max_y = 0;
+
+	// glyph quads of the first m_vertex_count characters of m_layout, grouped by atlas page.
+	// With a paragraph layout they are the quads of lines m_vertex_first_line to m_vertex_last_line (exclusive) instead
+	mutable std::vector<std::vector<detail::glyph_vertex>> m_vertices;
+	mutable std::size_t m_vertex_count = 0;
+	mutable std::size_t m_vertex_first_line = npos;
+	mutable std::size_t m_vertex_last_line = npos;
+
+	std::optional<paragraph_layout> m_paragraph;
+	float m_view_top = 0;
+	float m_view_height = 0;
+
+	// characters begin to end (exclusive) of a paragraph line are drawn, the next line starts at next.
+	// Spaces where a line is wrapped and the newline ending it are between end and next
+	struct line_info
+	{
+		std::size_t begin;
+		std::size_t end;
+		std::size_t next;
+		// in font pixels, without trailing spaces
+		float width;
+	};
+
+	// the first lines of the paragraph, only wrapped as far as they have been needed
+	mutable std::vector<line_info> m_lines;
+	// m_lines reaches the end of m_data
+	mutable bool m_lines_complete = false;
+	mutable std::uint64_t m_font_metrics_version = 0;
+
+	// index of the first character a mutation with these arguments can change
+	template <typename T, typename... Ts>
+	inline std::size_t first_index(const T &first, const Ts &...) const
+	{
+		using iterator = std::basic_string<uint32_t>::const_iterator;
+		if constexpr (std::is_integral_v<T>)
+			return static_cast<std::size_t>(first);
+		else if constexpr (std::is_convertible_v<T, iterator>)
+			return static_cast<std::size_t>(iterator(first) - m_data.cbegin());
+		else
+			return 0;
+	}
+	inline std::size_t first_index() const { return 0; }
+
+	/// @brief drop cached layout from character pos onwards
+	/// @param unchanged characters from here on are the same as before the mutation, shifted by shift. Paragraph lines starting there are kept
+	void invalidate(std::size_t pos, std::size_t unchanged = npos, std::ptrdiff_t shift = 0) const;
+	void invalidate_vertices() const;
+
+	// appending doesn't change the single line layout, but the last paragraph line may be wrapped differently
+	inline void appended(std::size_t pos) const
+	{
+		if (m_paragraph)
+			invalidate(pos);
+	}
+
+	// lay out characters added since the last call, only looking up their glyphs
+	/// @param exact wait for glyphs that are still being rasterized, instead of laying them out as empty
+	void update_layout(bool exact = false) const;
+	void update_bounds() const;
+	// right edge of the last laid out glyph's outline
+	float layout_right() const;
+	void update_vertices() const;
+	// mark the atlas pages of the quads and of the layout up to end as used now
+	void touch_pages(std::size_t end) const;
+
+	// add the quad of a glyph whose bottom left is at min, in font pixels
+	void push_glyph(vec2 min, const glyph_atlas::region &region) const;
+
+	// line break after the line starting at begin
+	line_info wrap_line(std::size_t begin, bool exact) const;
+	// true if line is the last one of the paragraph
+	bool is_last_line(const line_info &line) const;
+	// drop the lines that can change, then wrap again until the new breaks line up with the old ones from unchanged onwards
+	void invalidate_lines(std::size_t pos, std::size_t unchanged, std::ptrdiff_t shift) const;
+	// wrap lines until there are count or the end of the text is reached
+	void update_lines(std::size_t count, bool exact = false) const;
+	// drop what changes in the font made out of date
+	/// @param exact wrap lines with glyphs that were still being rasterized again
+	void update_paragraph(bool exact = false) const;
+	// wrap and lay out the lines in the visible region
+	void update_paragraph_vertices() const;
+
+	// distance between baselines, in font pixels
+	float line_advance() const;
+	// x of the line's first pen position, in font pixels
+	float line_offset(const line_info &line) const;
+	// bounds of every line, in font pixels
+	rect paragraph_rect() const;
 };
 SGL_END
\ No newline at end of file
@@ -53,11 +53,12 @@ public:
 	// make sure to activate texture unit before this
 	inline void use() const override
 	{
-		glBindTexture(GL_TEXTURE_2D, id);
+		detail::state().bind_texture_2d(id);
 	}
 
 	inline void destroy() override
 	{
+		detail::state().on_delete_texture(id);
 		glDeleteTextures(1, &id);
 	}
 
@@ -114,14 +115,20 @@ public:
 	void load(GLenum target_format, const void *data, GLsizei width, GLsizei height, int channel_count, bool flip = true);
 	void reserve(GLenum target_format, GLsizei width, GLsizei height);
 
+	// overwrite the rectangle at x, y (from the bottom left) with data of the given pixel format, the texture must already have storage
+	void update(GLint x, GLint y, GLsizei width, GLsizei height, GLenum pixel_format, const void *data) const;
+
+	// copy every texel, bottom row first, into data in the given pixel format
+	void read(GLenum pixel_format, void *data) const;
+
 	inline static void quit()
 	{
-		glBindTexture(GL_TEXTURE_2D, 0);
+		detail::state().bind_texture_2d(0);
 	}
 
 	inline static void activate_unit(int unit)
 	{
-		glActiveTexture(GL_TEXTURE0 + unit);
+		detail::state().set_active_texture(unit);
 	}
 };
 SGL_END
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "shaders.h"
+#include "object/buffers.h"
 #include <vector>
 
 SGL_BEG
@@ -147,14 +148,40 @@ public:
 	void send(shader &program, const std::string &name) const override;
 };
 
+/// @brief collection of lights. Shaders with variables::sgl_Lights read every light from one std140 uniform buffer,
+/// which is only rewritten when the lights change.
+/// Lights modified through the non-const iterators are assumed to have changed
 class lighting_engine
 {
 public:
-	inline lighting_engine() : m_global{}, m_has_global{} {}
+	// lights past these counts are ignored by the uniform buffer
+	static constexpr std::size_t max_directional_lights = 16;
+	static constexpr std::size_t max_positional_lights = 16;
+	static constexpr std::size_t max_spotlights = 16;
+
+	inline lighting_engine() : m_global{}, m_has_global{}, m_changed{true} {}
+
+	// the copy gets its own uniform buffer
+	inline lighting_engine(const lighting_engine &other) :
+		m_directional{other.m_directional}, m_positional{other.m_positional}, m_spotlight{other.m_spotlight}, m_global{other.m_global}, m_has_global{other.m_has_global}, m_changed{true}
+	{}
+	inline lighting_engine &operator=(const lighting_engine &other)
+	{
+		m_directional = other.m_directional;
+		m_positional = other.m_positional;
+		m_spotlight = other.m_spotlight;
+		m_global = other.m_global;
+		m_has_global = other.m_has_global;
+		m_changed = true;
+		return *this;
+	}
+
+	inline lighting_engine(lighting_engine &&) = default;
+	inline lighting_engine &operator=(lighting_engine &&) = default;
 
 	inline bool has_global_light() const { return m_has_global; }
-	inline void set_global_light(global_light light) { m_has_global = true; m_global = light; }
-	inline void remove_global_light() { m_has_global = false; }
+	inline void set_global_light(global_light light) { m_has_global = true; m_global = light; m_changed = true; }
+	inline void remove_global_light() { m_has_global = false; m_changed = true; }
 	inline global_light get_global_light() const { return m_global; }
 
 	inline bool has_directional_lights() const { return m_directional.size(); }
@@ -165,13 +192,13 @@ public:
 	inline std::size_t positional_lights_size() const { return m_positional.size(); }
 	inline std::size_t spotlights_size() const { return m_spotlight.size(); }
 
-	inline void add_directional_light(const directional_light &light) { m_directional.push_back(light); }
-	inline void add_positional_light(const positional_light &light) { m_positional.push_back(light); }
-	inline void add_spotlight(const spotlight &light) { m_spotlight.push_back(light); }
+	inline void add_directional_light(const directional_light &light) { m_directional.push_back(light); m_changed = true; }
+	inline void add_positional_light(const positional_light &light) { m_positional.push_back(light); m_changed = true; }
+	inline void add_spotlight(const spotlight &light) { m_spotlight.push_back(light); m_changed = true; }
 
-	inline void remove_directional_light(std::vector<directional_light>::const_iterator it) { m_directional.erase(it); }
-	inline void remove_positional_light(std::vector<positional_light>::const_iterator it) { m_positional.erase(it); }
-	inline void remove_spotlight(std::vector<spotlight>::const_iterator it) { m_spotlight.erase(it); }
+	inline void remove_directional_light(std::vector<directional_light>::const_iterator it) { m_directional.erase(it); m_changed = true; }
+	inline void remove_positional_light(std::vector<positional_light>::const_iterator it) { m_positional.erase(it); m_changed = true; }
+	inline void remove_spotlight(std::vector<spotlight>::const_iterator it) { m_spotlight.erase(it); m_changed = true; }
 
 	inline auto directional_lights_begin() const { return m_directional.begin(); }
 	inline auto directional_lights_end() const { return m_directional.end(); }
@@ -182,14 +209,21 @@ public:
 	inline auto spotlights_begin() const { return m_spotlight.begin(); }
 	inline auto spotlights_end() const { return m_spotlight.end(); }
 
-	inline auto directional_lights_begin() { return m_directional.begin(); }
+	inline auto directional_lights_begin() { m_changed = true; return m_directional.begin(); }
 	inline auto directional_lights_end() { return m_directional.end(); }
 
-	inline auto positional_lights_begin() { return m_positional.begin(); }
+	inline auto positional_lights_begin() { m_changed = true; return m_positional.begin(); }
 	inline auto positional_lights_end() { return m_positional.end(); }
 
-	inline auto spotlights_begin() { return m_spotlight.begin(); }
+	inline auto spotlights_begin() { m_changed = true; return m_spotlight.begin(); }
 	inline auto spotlights_end() { return m_spotlight.end(); }
+
+	/// @brief bind the uniform buffer to the lights binding point, uploading the lights first if they changed
+	void bind() const;
+
+	// binding point of the sgl_Lights uniform block
+	static unsigned int lights_binding;
+
 private:
 	std::vector<directional_light> m_directional;
 	std::vector<positional_light> m_positional;
@@ -197,6 +231,11 @@ private:
 
 	global_light m_global;
 	bool m_has_global;
+
+	mutable ubo m_buffer;
+	mutable bool m_changed;
+
+	void upload() const;
 };
 
 SGL_END
\ No newline at end of file
@@ -114,6 +114,33 @@ namespace variables
 		sgl_VertColor = sgl_VertNormal << 1,
 		// output of vertex shader/ input to fragment shader for texture coordinates
 		sgl_VertTextPos = sgl_VertColor << 1,
+		// per-instance attribute for the model matrix, used by instanced draws
+		sgl_InstanceModel = sgl_VertTextPos << 1,
+		// per-instance attribute for color, used by instanced draws
+		sgl_InstanceColor = sgl_InstanceModel << 1,
+
+		// std140 uniform block with every light of a lighting_engine, replaces sgl_GlobalLight, sgl_DirectionalLights, sgl_PositionalLights and sgl_Spotlights
+		// layout (std140) uniform sgl_Lights
+		// {
+		//   sgl_GlobalLight_t sgl_GlobalLight;
+		//   int sgl_DirectionalLightsSize;
+		//   int sgl_PostionalLightsSize;
+		//   int sgl_SpotlightsSize;
+		//   sgl_DirectionalLight_t sgl_DirectionalLights[lighting_engine::max_directional_lights];
+		//   sgl_PositionalLight_t sgl_PositionalLights[lighting_engine::max_positional_lights];
+		//   sgl_Spotlight_t sgl_Spotlights[lighting_engine::max_spotlights];
+		// };
+		sgl_Lights = sgl_InstanceColor << 1,
+
+		// std140 uniform block with the camera of the frame, shared by every shader. Replaces sgl_View and sgl_Proj
+		// layout (std140) uniform sgl_Camera
+		// {
+		//   mat4 sgl_View;
+		//   mat4 sgl_Proj;
+		//   mat4 sgl_ViewProj;
+		//   vec3 sgl_CameraPos; // world space position of the camera
+		// };
+		sgl_Camera = sgl_Lights << 1,
 	};
 }
 
@@ -135,11 +162,15 @@ namespace variables
 ///		sgl_DirectionalLight_t sgl_DirectionalLights[sgl_DirectionalLightsSize]; // contains array of directional lights
 ///		sgl_PositionalLight_t sgl_PositionalLights[sgl_PostionalLightsSize]; // contains array of positional lights
 ///		sgl_Spotlight_t sgl_Spotlights[sgl_SpotlightsSize]; // contains array of spotlights
+///		uniform sgl_Lights { ... }; // contains every light of the lighting engine, in place of the light uniforms above
+///		uniform sgl_Camera { ... }; // contains the view, projection, view-projection and camera position, in place of sgl_View and sgl_Proj
 /// Standardized attributes for vertex shader:
 ///		vec3 sgl_Pos; // contains the vertex position
 ///		vec3 sgl_Normal; // contains the vertex normal
 ///		vec4 sgl_ColorAttrib; // contains the vertex color
 ///		vec2 sgl_TextPos; // contains the vertex texture coordinate
+///		mat4 sgl_InstanceModel; // contains the model matrix of the instance (instanced draws only)
+///		vec4 sgl_InstanceColor; // contains the color of the instance (instanced draws only)
 /// Standardized out variables for the vertex shader
 ///		vec3 sgl_VertPos; // contains the vertex position
 ///		vec3 sgl_VertNormal; // contains the vertex normal
@@ -237,14 +268,14 @@ public:
 	/// <param name="variables">Bit mask of all variables to be included. Fields are defined in variables::variable_type</param>
 	void generate_shader(const std::string &vertex, const std::string &fragment, unsigned int variables);
 
-	inline void set_color_uniform(vec4 color) { m_shader.set_uniform("sgl_Color", color); }
-	inline void set_view_uniform(const mat4 &view) { m_shader.set_uniform("sgl_View", view); }
-	inline void set_model_uniform(const mat4 &model) { m_shader.set_uniform("sgl_Model", model); }
-	inline void set_proj_uniform(const mat4 &proj) { m_shader.set_uniform("sgl_Proj", proj); }
-	inline void set_modelView_uniform(const mat4 &modelView) { m_shader.set_uniform("sgl_ModelView", modelView); }
-	inline void set_modelViewProj_uniform(const mat4 &modelViewProj) { m_shader.set_uniform("sgl_ModelViewProj", modelViewProj); }
-	inline void set_inverseModelView_uniform(const mat4 &inverseModelView) { m_shader.set_uniform("sgl_InverseModelView", inverseModelView); }
-	inline void set_texture_uniform(const texture &texture) { m_shader.set_uniform("sgl_Texture", texture); }
+	inline void set_color_uniform(vec4 color) { m_shader.set_uniform(m_color, color); }
+	inline void set_view_uniform(const mat4 &view) { m_shader.set_uniform(m_view, view); }
+	inline void set_model_uniform(const mat4 &model) { m_shader.set_uniform(m_model, model); }
+	inline void set_proj_uniform(const mat4 &proj) { m_shader.set_uniform(m_proj, proj); }
+	inline void set_modelView_uniform(const mat4 &modelView) { m_shader.set_uniform(m_modelView, modelView); }
+	inline void set_modelViewProj_uniform(const mat4 &modelViewProj) { m_shader.set_uniform(m_modelViewProj, modelViewProj); }
+	inline void set_inverseModelView_uniform(const mat4 &inverseModelView) { m_shader.set_uniform(m_inverseModelView, inverseModelView); }
+	inline void set_texture_uniform(const texture &texture) { m_shader.set_uniform(m_texture, texture); }
 
 	inline void set_material_uniform(const material &mat) { m_shader.set_uniform("sgl_Material", mat); }
 	inline void set_textureMaterial_uniform(const texture_material &mat) { m_shader.set_uniform("sgl_TextureMaterial", mat); }
@@ -276,6 +307,10 @@ public:
 	inline bool has_normal_out_var() const { return m_variables & variables::sgl_VertNormal; }
 	inline bool has_color_out_var() const { return m_variables & variables::sgl_VertColor; }
 	inline bool has_textPos_out_var() const { return m_variables & variables::sgl_VertTextPos; }
+	inline bool has_instanceModel_attribute() const { return m_variables & variables::sgl_InstanceModel; }
+	inline bool has_instanceColor_attribute() const { return m_variables & variables::sgl_InstanceColor; }
+	inline bool has_lights_block() const { return m_variables & variables::sgl_Lights; }
+	inline bool has_camera_block() const { return m_variables & variables::sgl_Camera; }
 
 	/// <summary>
 	/// Set lighting uniforms as defined in engine. Will only set the amount of lights as defined in the shader, potentially ignoring some lights in engine
@@ -313,16 +348,12 @@ public:
 
 	inline void bind()
 	{
-		static const std::string directionals_size = "sgl_DirectionalLightsSize";
-		static const std::string positionals_size = "sgl_PostionalLightsSize";
-		static const std::string spotlights_size = "sgl_SpotlightsSize";
-
 		if (has_directionalLights_uniform())
-			m_shader.set_uniform(directionals_size, static_cast<int>(m_directionals.size()));
+			m_shader.set_uniform(m_directionalsSize, static_cast<int>(m_directionals.size()));
 		if (has_positionalLights_uniform())
-			m_shader.set_uniform(positionals_size, static_cast<int>(m_positionals.size()));
+			m_shader.set_uniform(m_positionalsSize, static_cast<int>(m_positionals.size()));
 		if (has_spotlights_uniform())
-			m_shader.set_uniform(spotlights_size, static_cast<int>(m_spotlights.size()));
+			m_shader.set_uniform(m_spotlightsSize, static_cast<int>(m_spotlights.size()));
 
 		m_shader.bind();
 	}
@@ -331,6 +362,12 @@ public:
 	static unsigned int normal_attribute_loc;
 	static unsigned int color_attribute_loc;
 	static unsigned int textPos_attribute_loc;
+	// sgl_InstanceModel takes four consecutive locations, one per column
+	static unsigned int instanceModel_attribute_loc;
+	static unsigned int instanceColor_attribute_loc;
+
+	// binding point of the sgl_Camera uniform block
+	static unsigned int camera_binding;
 
 private:
 	shader m_shader;
@@ -338,6 +375,19 @@ private:
 	std::vector<std::string> m_positionals;
 	std::vector<std::string> m_spotlights;
 	unsigned int m_variables;
+
+	// resolved by generate_shader, invalid if the variable isn't included
+	uniform<vec4> m_color;
+	uniform<mat4> m_view;
+	uniform<mat4> m_model;
+	uniform<mat4> m_proj;
+	uniform<mat4> m_modelView;
+	uniform<mat4> m_modelViewProj;
+	uniform<mat4> m_inverseModelView;
+	uniform<texture> m_texture;
+	uniform<int> m_directionalsSize;
+	uniform<int> m_positionalsSize;
+	uniform<int> m_spotlightsSize;
 };
 
 render_shader phong_shader(unsigned int num_directional, unsigned int num_positional, unsigned int num_spotlights, unsigned int variables);
@@ -5,6 +5,9 @@
 
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <vector>
+#include <cstring>
 
 SGL_BEG
 
@@ -19,6 +22,25 @@ public:
 	virtual void send(shader &program, const std::string &name) const = 0;
 };
 
+/// @brief handle to a uniform of type T, resolved once with shader::get_uniform instead of looking up the name every time it's set
+template <typename T>
+class uniform
+{
+public:
+	inline uniform() : loc{-1} {}
+
+	/// @return false if the uniform doesn't exist or was optimized out of the program
+	inline bool valid() const { return loc != -1; }
+	inline int location() const { return loc; }
+
+private:
+	inline explicit uniform(int location) : loc{location} {}
+
+	int loc;
+
+	friend class shader;
+};
+
 /// <summary>
 /// OpenGL shader class with uniform support
 /// </summary>
@@ -33,7 +55,7 @@ public:
 		id = 0;
 	}
 
-	inline shader(shader &&o) noexcept : id{o.id}, textures{std::move(o.textures)}
+	inline shader(shader &&o) noexcept : id{o.id}, textures{std::move(o.textures)}, locations{std::move(o.locations)}, values{std::move(o.values)}
 	{
 		o.id = 0;
 	}
@@ -45,6 +67,8 @@ public:
 		id = o.id;
 		o.id = 0;
 		textures = std::move(o.textures);
+		locations = std::move(o.locations);
+		values = std::move(o.values);
 		return *this;
 	}
 
@@ -74,17 +98,74 @@ public:
 		val.send(*this, name);
 	}
 
+	/// @brief resolve the location of a uniform. Handles are invalidated when the shader is loaded again
+	template <typename T>
+	inline uniform<T> get_uniform(const std::string &name) { return uniform<T>(get_loc(name)); }
+
+	/// @brief set a uniform through a handle. The value is only uploaded if it differs from the last value set
+	template <typename T>
+	inline void set_uniform(uniform<T> u, const T &val)
+	{
+		if (u.valid() && update_value(u.loc, &val, sizeof(T)))
+			upload(u.loc, val);
+	}
+
+	inline void set_uniform(uniform<texture> u, const texture &val)
+	{
+		if (u.valid())
+			textures[u.loc] = &val;
+	}
+
 	void bind();
 
 	inline unsigned int index() const { return id; }
 
 private:
+	// last value set to a uniform location
+	struct uniform_value
+	{
+		alignas(16) unsigned char data[sizeof(mat4)];
+		std::size_t size;
+	};
+
 	unsigned int id;
 
 	std::map<int, const texture *> textures;
 
+	// cached results of glGetUniformLocation, and uniform values indexed by location
+	std::unordered_map<std::string, int> locations;
+	std::vector<uniform_value> values;
+
 	void destroy();
 	int get_loc(const std::string &name);
+
+	// returns true if val differs from the cached value at loc, and stores it
+	inline bool update_value(int loc, const void *val, std::size_t size)
+	{
+		if (static_cast<std::size_t>(loc) >= values.size())
+			values.resize(loc + 1, uniform_value{{}, 0});
+
+		uniform_value &cached = values[loc];
+		if (cached.size == size && !std::memcmp(cached.data, val, size))
+			return false;
+
+		std::memcpy(cached.data, val, size);
+		cached.size = size;
+		return true;
+	}
+
+	void upload(int loc, float val);
+	void upload(int loc, vec2 val);
+	void upload(int loc, vec3 val);
+	void upload(int loc, vec4 val);
+
+	void upload(int loc, int val);
+	void upload(int loc, ivec2 val);
+	void upload(int loc, ivec3 val);
+	void upload(int loc, ivec4 val);
+
+	void upload(int loc, const mat3 &val);
+	void upload(int loc, const mat4 &val);
 };
 
 SGL_END
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+#include "macro.h"
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+SGL_BEG
+
+// codepoint substituted for every invalid sequence
+constexpr uint32_t replacement_character = 0xFFFD;
+
+/// @brief decode utf-8 and append the codepoints to out. Overlong encodings, surrogates, codepoints past U+10FFFF and truncated sequences
+/// each become replacement_character. out only reallocates if its capacity is smaller than out.size() + in.size().
+/// Runs of valid 1 to 3 byte sequences are decoded 16 bytes at a time where SIMD is available
+void append_utf8(std::basic_string<uint32_t> &out, std::string_view in);
+
+/// @brief decode utf-16 and append the codepoints to out, an unpaired surrogate becomes replacement_character
+void append_utf16(std::basic_string<uint32_t> &out, std::u16string_view in);
+
+/// @brief append wide characters, which are utf-16 where wchar_t is 2 bytes (windows) and utf-32 elsewhere
+void append_wide(std::basic_string<uint32_t> &out, std::wstring_view in);
+
+SGL_END
@@ -0,0 +1,158 @@
+#include "object/glyph_atlas.h"
+#include "utils/error.h"
+
+#include <algorithm>
+#include <cstddef>
+
+SGL_BEG
+
+bool glyph_atlas::add(const unsigned char *bitmap, int width, int height, int pitch, region &res, bool over_budget)
+{
+	res = {};
+
+	if (width <= 0 || height <= 0)
+		return true;
+
+	if (width + padding > m_page_size || height + padding > m_page_size)
+	{
+		detail::log_error(error("Bitmap is larger than a glyph atlas page.", error_code::invalid_argument));
+		return true;
+	}
+
+	unsigned int index = 0;
+	for (; index < m_pages.size(); ++index)
+		if (place(m_pages[index], width, height, res.pos))
+			break;
+
+	if (index == m_pages.size())
+	{
+		if (m_pages.size() >= m_max_pages && !over_budget)
+			return false;
+		place(add_page(), width, height, res.pos);
+	}
+
+	res.page = index;
+	res.size = {width, height};
+
+	// the page is stored bottom row first, so flip the rows
+	std::vector<unsigned char> flipped(static_cast<std::size_t>(width) * height);
+	for (int y = 0; y < height; ++y)
+	{
+		const unsigned char *in = bitmap + static_cast<std::ptrdiff_t>(height - y - 1) * pitch;
+		std::copy(in, in + width, flipped.begin() + static_cast<std::ptrdiff_t>(y) * width);
+	}
+
+	// rows are width bytes long, without padding. The alignment is cached, so neither saving nor restoring it queries GL
+	detail::unpack_alignment_lock alock;
+	detail::state().set_unpack_alignment(1);
+	m_pages[index].text.update(res.pos.x, res.pos.y, width, height, GL_RED, flipped.data());
+
+	float size = static_cast<float>(m_page_size);
+	res.text_min = vec2(res.pos) / size;
+	res.text_max = vec2(res.pos + res.size) / size;
+
+	return true;
+}
+
+void glyph_atlas::clear()
+{
+	for (auto &p : m_pages)
+	{
+		p.shelves.clear();
+		p.next_y = 0;
+		p.last_use = 0;
+		clear_texels(p);
+	}
+}
+
+unsigned int glyph_atlas::evict(std::uint64_t keep)
+{
+	unsigned int res = no_page;
+	for (unsigned int i = 0; i < m_pages.size(); ++i)
+		if (m_pages[i].last_use < keep && (res == no_page || m_pages[i].last_use < m_pages[res].last_use))
+			res = i;
+
+	if (res == no_page)
+		return res;
+
+	page_data &p = m_pages[res];
+	p.shelves.clear();
+	p.next_y = 0;
+	p.last_use = 0;
+	clear_texels(p);
+
+	return res;
+}
+
+void glyph_atlas::read_page(unsigned int index, unsigned char *out) const
+{
+	detail::pack_alignment_lock alock;
+	detail::state().set_pack_alignment(1);
+	m_pages[index].text.read(GL_RED, out);
+}
+
+unsigned int glyph_atlas::restore_page(const unsigned char *texels, std::vector<shelf> shelves, int next_y)
+{
+	page_data &p = add_page(texels);
+	p.shelves = std::move(shelves);
+	p.next_y = next_y;
+
+	return static_cast<unsigned int>(m_pages.size() - 1);
+}
+
+bool glyph_atlas::place(page_data &p, int width, int height, ivec2 &pos)
+{
+	int w = width + padding;
+	int h = height + padding;
+
+	// the shortest shelf the bitmap fits on wastes the least space
+	shelf *best = nullptr;
+	for (auto &s : p.shelves)
+		if (s.height >= h && s.x + w <= m_page_size && (!best || s.height < best->height))
+			best = &s;
+
+	if (!best)
+	{
+		if (p.next_y + h > m_page_size)
+			return false;
+
+		p.shelves.push_back({p.next_y, h, 0});
+		p.next_y += h;
+		best = &p.shelves.back();
+	}
+
+	pos = {best->x, best->y};
+	best->x += w;
+	return true;
+}
+
+glyph_atlas::page_data &glyph_atlas::add_page(const unsigned char *texels)
+{
+	page_data &res = m_pages.emplace_back();
+	res.next_y = 0;
+	res.last_use = 0;
+
+	res.text.reserve(GL_R8, m_page_size, m_page_size);
+	if (texels)
+	{
+		detail::unpack_alignment_lock alock;
+		detail::state().set_unpack_alignment(1);
+		res.text.update(0, 0, m_page_size, m_page_size, GL_RED, texels);
+	}
+	else // padding must be empty, so start from a cleared page instead of undefined storage
+		clear_texels(res);
+	res.text.set_parameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	res.text.set_parameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	res.text.set_parameter(GL_TEXTURE_MIN_FILTER, m_min_filter);
+	res.text.set_parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	return res;
+}
+
+void glyph_atlas::clear_texels(page_data &p)
+{
+	std::vector<unsigned char> empty(static_cast<std::size_t>(m_page_size) * m_page_size);
+	p.text.update(0, 0, m_page_size, m_page_size, GL_RED, empty.data());
+}
+
+SGL_END
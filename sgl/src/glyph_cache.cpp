@@ -0,0 +1,278 @@
+#include "object/text.h"
+#include "utils/error.h"
+
+#include "glyph_rasterizer.h"
+#include "mapped_file.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+SGL_BEG
+
+// font::save_cache files are, in native byte order:
+// cache_header, cache_page[page_count], glyph_atlas::shelf[shelf_count], cache_glyph[glyph_count],
+// then page_count pages of page_size * page_size texels, bottom row first
+namespace glyph_cache_detail
+{
+	constexpr char magic[4] = {'S', 'G', 'L', 'G'};
+	// bump whenever the layout below changes, older files are then ignored
+	constexpr std::uint32_t format_version = 1;
+
+	struct cache_header
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint64_t font_hash;
+		std::uint32_t height;
+		std::uint32_t mode;
+		std::int32_t page_size;
+		std::uint32_t page_count;
+		std::uint32_t shelf_count;
+		std::uint32_t glyph_count;
+	};
+
+	struct cache_page
+	{
+		std::int32_t next_y;
+		std::uint32_t shelf_count;
+	};
+
+	struct cache_glyph
+	{
+		std::uint32_t c;
+		std::uint32_t page;
+		std::int32_t pos[2];
+		std::int32_t size[2];
+		std::int32_t offset[2];
+		std::uint32_t advance;
+	};
+
+	// FNV-1a
+	std::uint64_t hash(const unsigned char *data, std::size_t size)
+	{
+		std::uint64_t res = 14695981039346656037ull;
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			res ^= data[i];
+			res *= 1099511628211ull;
+		}
+		return res;
+	}
+
+	// reads consecutive records out of a mapped cache file, failing once the file is too short
+	class reader
+	{
+	public:
+		inline reader(const unsigned char *data, std::size_t size) : m_data{data}, m_size{size}, m_offset{} {}
+
+		template <typename T>
+		inline bool read(T &res)
+		{
+			if (m_size - m_offset < sizeof(T))
+				return false;
+			// the file has no alignment guarantees
+			std::memcpy(&res, m_data + m_offset, sizeof(T));
+			m_offset += sizeof(T);
+			return true;
+		}
+
+		// skip size bytes, returning where they start or nullptr
+		inline const unsigned char *skip(std::size_t size)
+		{
+			if (m_size - m_offset < size)
+				return nullptr;
+			const unsigned char *res = m_data + m_offset;
+			m_offset += size;
+			return res;
+		}
+
+	private:
+		const unsigned char *m_data;
+		std::size_t m_size;
+		std::size_t m_offset;
+	};
+
+	template <typename T>
+	void write(std::ofstream &out, const T &value)
+	{
+		out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+}
+
+std::uint64_t font::source_hash() const
+{
+	if (m_data)
+		return glyph_cache_detail::hash(static_cast<const unsigned char *>(m_data), m_data_size);
+
+	detail::mapped_file file;
+	if (!file.open(m_file_name))
+		return 0;
+	return glyph_cache_detail::hash(file.data(), file.size());
+}
+
+bool font::save_cache(const std::string &file_name) const
+{
+	using namespace glyph_cache_detail;
+
+	if (!face.face)
+		return false;
+
+	// glyphs still in flight would otherwise be missing from the cache
+	if (m_rasterizer)
+	{
+		m_rasterizer->wait();
+		poll();
+	}
+
+	std::vector<std::pair<uint32_t, const character *>> glyphs;
+	glyphs.reserve(m_chars.size() + flat_count);
+	for (uint32_t c = 0; c < flat_count; ++c)
+		if (m_flat_loaded[c])
+			glyphs.emplace_back(c, &m_flat[c]);
+	for (const auto &[c, ch] : m_chars)
+		glyphs.emplace_back(c, &ch);
+
+	cache_header header;
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = format_version;
+	header.font_hash = source_hash();
+	header.height = face.size;
+	header.mode = static_cast<std::uint32_t>(m_mode);
+	header.page_size = m_atlas.page_size();
+	header.page_count = static_cast<std::uint32_t>(m_atlas.page_count());
+	header.shelf_count = 0;
+	for (unsigned int i = 0; i < header.page_count; ++i)
+		header.shelf_count += static_cast<std::uint32_t>(m_atlas.shelves(i).size());
+	header.glyph_count = static_cast<std::uint32_t>(glyphs.size());
+
+	std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		detail::log_error(error("Could not open glyph cache " + file_name + '.', error_code::file_open_failure));
+		return false;
+	}
+
+	write(out, header);
+
+	for (unsigned int i = 0; i < header.page_count; ++i)
+		write(out, cache_page{m_atlas.next_row(i), static_cast<std::uint32_t>(m_atlas.shelves(i).size())});
+
+	for (unsigned int i = 0; i < header.page_count; ++i)
+		for (const auto &s : m_atlas.shelves(i))
+			write(out, s);
+
+	for (const auto &[c, ch] : glyphs)
+	{
+		const glyph_atlas::region &r = ch->region;
+		write(out, cache_glyph{c, r.page, {r.pos.x, r.pos.y}, {r.size.x, r.size.y}, {ch->offset.x, ch->offset.y}, ch->advance});
+	}
+
+	std::vector<unsigned char> texels(static_cast<std::size_t>(header.page_size) * header.page_size);
+	for (unsigned int i = 0; i < header.page_count; ++i)
+	{
+		m_atlas.read_page(i, texels.data());
+		out.write(reinterpret_cast<const char *>(texels.data()), static_cast<std::streamsize>(texels.size()));
+	}
+
+	if (!out)
+	{
+		detail::log_error(error("Could not write glyph cache " + file_name + '.', error_code::file_open_failure));
+		return false;
+	}
+
+	return true;
+}
+
+bool font::load_cache(const std::string &file_name)
+{
+	using namespace glyph_cache_detail;
+
+	if (!face.face)
+		return false;
+
+	detail::mapped_file file;
+	if (!file.open(file_name))
+		return false;
+
+	reader in(file.data(), file.size());
+
+	cache_header header;
+	if (!in.read(header) || std::memcmp(header.magic, magic, sizeof(magic)) || header.version != format_version)
+		return false;
+
+	// a cache of another font, size or mode, or one whose pages were a different size
+	if (header.height != face.size || header.mode != static_cast<std::uint32_t>(m_mode) || header.page_size != m_atlas.page_size() ||
+		header.font_hash != source_hash())
+		return false;
+
+	std::size_t page_bytes = static_cast<std::size_t>(header.page_size) * header.page_size;
+	std::size_t expected = sizeof(cache_header) + header.page_count * (sizeof(cache_page) + page_bytes) +
+						   header.shelf_count * sizeof(glyph_atlas::shelf) + header.glyph_count * sizeof(cache_glyph);
+	if (file.size() < expected)
+	{
+		detail::log_error(error("Glyph cache " + file_name + " is truncated.", error_code::unrecognized_file_format));
+		return false;
+	}
+
+	// read everything before touching the font, so a malformed file leaves it unchanged
+	std::vector<cache_page> pages(header.page_count);
+	std::size_t shelf_total = 0;
+	for (auto &p : pages)
+	{
+		if (!in.read(p))
+			return false;
+		shelf_total += p.shelf_count;
+	}
+	if (shelf_total != header.shelf_count)
+		return false;
+
+	std::vector<glyph_atlas::shelf> shelves(header.shelf_count);
+	for (auto &s : shelves)
+		if (!in.read(s))
+			return false;
+
+	std::vector<cache_glyph> glyphs(header.glyph_count);
+	for (auto &g : glyphs)
+		if (!in.read(g) || (g.size[0] && g.page >= header.page_count))
+			return false;
+
+	const unsigned char *texels = in.skip(page_bytes * header.page_count);
+	if (!texels)
+		return false;
+
+	clear_glyphs();
+
+	auto shelf = shelves.begin();
+	for (std::size_t i = 0; i < pages.size(); ++i)
+	{
+		m_atlas.restore_page(texels + i * page_bytes, {shelf, shelf + pages[i].shelf_count}, pages[i].next_y);
+		shelf += pages[i].shelf_count;
+	}
+
+	float size = static_cast<float>(header.page_size);
+	for (const auto &g : glyphs)
+	{
+		character res;
+		res.region.page = g.size[0] ? g.page : 0;
+		res.region.pos = {g.pos[0], g.pos[1]};
+		res.region.size = {g.size[0], g.size[1]};
+		res.region.text_min = vec2(res.region.pos) / size;
+		res.region.text_max = vec2(res.region.pos + res.region.size) / size;
+		res.offset = {g.offset[0], g.offset[1]};
+		res.advance = g.advance;
+		res.height = face.size;
+
+		if (g.c < flat_count)
+		{
+			m_flat[g.c] = res;
+			m_flat_loaded[g.c] = true;
+		}
+		else
+			m_chars[g.c] = res;
+	}
+
+	return true;
+}
+
+SGL_END
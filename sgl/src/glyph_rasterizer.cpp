@@ -0,0 +1,169 @@
+#include "glyph_rasterizer.h"
+#include "utils/error.h"
+
+#include <algorithm>
+#include <iterator>
+
+SGL_BEG
+DETAIL_BEG
+
+void configure_library(FT_Library library)
+{
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11)
+	// set explicitly so the padding stays sdf_spread even if FreeType's default changes
+	FT_Int spread = sdf_spread;
+	FT_Property_Set(library, "sdf", "spread", &spread);
+	FT_Property_Set(library, "bsdf", "spread", &spread);
+#else
+	(void)library;
+#endif
+}
+
+library_handle::library_handle() : library{}
+{
+	if (FT_Init_FreeType(&library))
+		detail::log_error(error("Could not initialize freetype.", error_code::freetype_initialization_failure));
+	else
+		configure_library(library);
+}
+
+library_handle::~library_handle()
+{
+	FT_Done_FreeType(library);
+}
+
+bool rasterize(FT_Face face, uint32_t c, bool sdf, glyph_bitmap &res)
+{
+	res.c = c;
+	res.ok = false;
+	res.width = res.rows = 0;
+	res.pixels.clear();
+	res.offset = {};
+	res.advance = 0;
+
+	if (!face)
+		return false;
+
+	if (sdf)
+	{
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11)
+		// render the outline with the sdf renderer instead of the default coverage one
+		if (FT_Load_Char(face, c, FT_LOAD_DEFAULT) || FT_Render_Glyph(face->glyph, FT_RENDER_MODE_SDF))
+			return false;
+#else
+		return false;
+#endif
+	}
+	else if (FT_Load_Char(face, c, FT_LOAD_RENDER))
+		return false;
+
+	const FT_Bitmap &bitmap = face->glyph->bitmap;
+	res.width = static_cast<int>(bitmap.width);
+	res.rows = static_cast<int>(bitmap.rows);
+	res.pixels.resize(static_cast<std::size_t>(res.width) * res.rows);
+	for (int y = 0; y < res.rows; ++y)
+	{
+		const unsigned char *in = bitmap.buffer + static_cast<std::ptrdiff_t>(y) * bitmap.pitch;
+		std::copy(in, in + res.width, res.pixels.begin() + static_cast<std::ptrdiff_t>(y) * res.width);
+	}
+
+	res.offset.x = face->glyph->bitmap_left;
+	res.offset.y = face->glyph->bitmap_top;
+	res.advance = static_cast<unsigned int>(face->glyph->advance.x);
+	res.ok = true;
+
+	return true;
+}
+
+glyph_rasterizer::glyph_rasterizer(font_source source, unsigned int height, bool sdf, unsigned int threads) : m_source{std::move(source)}, m_height{height}, m_sdf{sdf},
+																										   m_busy{}, m_stop{}
+{
+	m_threads.reserve(threads);
+	for (unsigned int i = 0; i < threads; ++i)
+		m_threads.emplace_back(&glyph_rasterizer::run, this);
+}
+
+glyph_rasterizer::~glyph_rasterizer()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_work.notify_all();
+
+	for (auto &t : m_threads)
+		t.join();
+}
+
+void glyph_rasterizer::request(uint32_t c)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_jobs.push_back(c);
+	}
+	m_work.notify_one();
+}
+
+void glyph_rasterizer::take(std::vector<glyph_bitmap> &out)
+{
+	std::lock_guard lock(m_mutex);
+	std::move(m_ready.begin(), m_ready.end(), std::back_inserter(out));
+	m_ready.clear();
+}
+
+void glyph_rasterizer::wait()
+{
+	std::unique_lock lock(m_mutex);
+	m_idle.wait(lock, [this] { return m_jobs.empty() && !m_busy; });
+}
+
+void glyph_rasterizer::run()
+{
+	// library_handle logs, which isn't safe off the GL thread
+	FT_Library lib{};
+	FT_Face face{};
+	if (!FT_Init_FreeType(&lib))
+	{
+		configure_library(lib);
+		FT_Error failed = m_source.data ? FT_New_Memory_Face(lib, reinterpret_cast<const FT_Byte *>(m_source.data), static_cast<FT_Long>(m_source.size), 0, &face)
+									   : FT_New_Face(lib, m_source.file_name.c_str(), 0, &face);
+		if (failed)
+			face = nullptr;
+		else
+			FT_Set_Pixel_Sizes(face, 0, m_height);
+	}
+
+	while (true)
+	{
+		uint32_t c;
+		{
+			std::unique_lock lock(m_mutex);
+			m_work.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+			if (m_stop)
+				break;
+
+			c = m_jobs.front();
+			m_jobs.pop_front();
+			++m_busy;
+		}
+
+		// a face that failed to open produces failed glyphs, which are logged on the GL thread
+		glyph_bitmap res;
+		rasterize(face, c, m_sdf, res);
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_ready.push_back(std::move(res));
+			--m_busy;
+			if (m_jobs.empty() && !m_busy)
+				m_idle.notify_all();
+		}
+	}
+
+	if (face)
+		FT_Done_Face(face);
+	FT_Done_FreeType(lib);
+}
+
+DETAIL_END
+SGL_END
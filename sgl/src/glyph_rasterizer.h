@@ -0,0 +1,102 @@
+#pragma once
+#include "macro.h"
+#include "math/vec.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_MODULE_H
+
+SGL_BEG
+DETAIL_BEG
+
+// pixels of distance field around each glyph in sdf mode, its bitmap is padded by this much on every side
+constexpr int sdf_spread = 8;
+
+// apply the settings every library rasterizing glyphs needs
+void configure_library(FT_Library library);
+
+struct library_handle
+{
+	FT_Library library;
+
+	library_handle();
+	~library_handle();
+};
+
+// bitmap and metrics of one rasterized glyph
+struct glyph_bitmap
+{
+	uint32_t c;
+	// false if FreeType couldn't render the glyph, the metrics are then 0
+	bool ok;
+
+	int width;
+	int rows;
+	// rows from top to bottom, width bytes each
+	std::vector<unsigned char> pixels;
+
+	ivec2 offset;
+	unsigned int advance;
+};
+
+// render c with face into res, doesn't log errors so it can be called from any thread
+bool rasterize(FT_Face face, uint32_t c, bool sdf, glyph_bitmap &res);
+
+// where a font's face is loaded from, data is used instead of file_name if not nullptr
+struct font_source
+{
+	std::string file_name;
+	const void *data;
+	std::size_t size;
+};
+
+/// @brief worker threads that rasterize requested glyphs into cpu bitmaps.
+/// Each worker opens its own FT_Library and FT_Face, FreeType objects are never shared between threads
+class glyph_rasterizer
+{
+public:
+	glyph_rasterizer(const glyph_rasterizer &) = delete;
+	glyph_rasterizer &operator=(const glyph_rasterizer &) = delete;
+
+	glyph_rasterizer(font_source source, unsigned int height, bool sdf, unsigned int threads);
+	~glyph_rasterizer();
+
+	void request(uint32_t c);
+
+	// move every finished glyph to the end of out
+	void take(std::vector<glyph_bitmap> &out);
+
+	// block until every requested glyph is finished
+	void wait();
+
+private:
+	font_source m_source;
+	unsigned int m_height;
+	bool m_sdf;
+
+	std::mutex m_mutex;
+	// signaled when a job is added or the workers should stop
+	std::condition_variable m_work;
+	// signaled when the last job is finished
+	std::condition_variable m_idle;
+
+	std::deque<uint32_t> m_jobs;
+	std::vector<glyph_bitmap> m_ready;
+	unsigned int m_busy;
+	bool m_stop;
+
+	std::vector<std::thread> m_threads;
+
+	void run();
+};
+
+DETAIL_END
+SGL_END
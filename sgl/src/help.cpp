@@ -3,6 +3,8 @@
 
 #include "object/render_target.h"
 
+#include <cstddef>
+
 SGL_BEG
 DETAIL_BEG
 
@@ -12,7 +14,13 @@ void setup_shader(render_shader &program, const mat4 &m, const lighting_engine *
 		program.set_texture_uniform(*text);
 
 	if (engine)
-		program.set_lighting_uniforms(*engine);
+	{
+		// the block is shared by every shader and only rewritten when the lights change
+		if (program.has_lights_block())
+			engine->bind();
+		else
+			program.set_lighting_uniforms(*engine);
+	}
 
 	if (program.has_color_uniform())
 		program.set_color_uniform(color);
@@ -27,33 +35,31 @@ void setup_shader(render_shader &program, const mat4 &m, const lighting_engine *
 			program.set_textureMaterial_uniform(*text_material_base);
 	}
 
-	auto *v = get_view();
-	auto *p = get_projection();
+	// view, projection and their product are computed once per camera change, not per draw
+	const camera_data &camera = get_camera();
 
-	if (!p)
-		p = &detail::identity_ref();
-	if (!v)
-		v = &detail::identity_ref();
+	if (program.has_camera_block())
+		bind_camera();
 
-	if (program.has_modelViewProj_uniform() || program.has_modelView_uniform() || program.has_inverseModelView_uniform())
+	if (program.has_modelView_uniform() || program.has_inverseModelView_uniform())
 	{
-		mat4 mv = *v;
-		mv *= m;
+		mat4 mv = camera.view * m;
 
 		if (program.has_inverseModelView_uniform())
 			program.set_inverseModelView_uniform(inverse(mv));
 		if (program.has_modelView_uniform())
 			program.set_modelView_uniform(mv);
-		if (program.has_modelViewProj_uniform())
-			program.set_modelViewProj_uniform((*p) * mv);
 	}
 
+	if (program.has_modelViewProj_uniform())
+		program.set_modelViewProj_uniform(camera.view_proj * m);
+
 	if (program.has_model_uniform())
 		program.set_model_uniform(m);
 	if (program.has_view_uniform())
-		program.set_view_uniform(*v);
+		program.set_view_uniform(camera.view);
 	if (program.has_proj_uniform())
-		program.set_proj_uniform(*p);
+		program.set_proj_uniform(camera.proj);
 
 	program.bind();
 }
@@ -64,37 +70,74 @@ const mat4 &identity_ref()
 	return id;
 }
 
-vbo make_rect_vbo()
+bool is_culled(const bound &local, const mat4 &model)
 {
-	vbo v;
-	v.generate();
-	v.reserve_data(4 * sizeof(vec3), GL_STREAM_DRAW);
-	return v;
+	return get_frustum_culling() && !get_frustum().intersects(local, model);
 }
 
-vbo &rect_obj_vbo()
+quad_type::quad_type() : rendervao_type()
 {
-	static vbo res = make_rect_vbo();
-	return res;
+	struct vertex
+	{
+		vec3 pos;
+		vec3 normal;
+		vec2 text_pos;
+	};
+
+	// normal is cross(right, -up), the same as the rectangles used to compute per draw
+	static constexpr vertex vertices[4] = {
+		{{0, 0, 0}, {0, 0, -1}, {0, 0}},
+		{{1, 0, 0}, {0, 0, -1}, {1, 0}},
+		{{1, 1, 0}, {0, 0, -1}, {1, 1}},
+		{{0, 1, 0}, {0, 0, -1}, {0, 1}},
+	};
+
+	detail::vao_lock lvao;
+	detail::vbo_lock lvbo;
+
+	m_buffer.generate();
+	m_buffer.attach_data(vertices, GL_STATIC_DRAW);
+
+	m_vao.generate();
+	m_vao.use();
+
+	m_buffer.use();
+	glEnableVertexAttribArray(render_shader::pos_attribute_loc);
+	glVertexAttribPointer(render_shader::pos_attribute_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void *)offsetof(vertex, pos));
+
+	glEnableVertexAttribArray(render_shader::normal_attribute_loc);
+	glVertexAttribPointer(render_shader::normal_attribute_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void *)offsetof(vertex, normal));
+
+	glEnableVertexAttribArray(render_shader::textPos_attribute_loc);
+	glVertexAttribPointer(render_shader::textPos_attribute_loc, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void *)offsetof(vertex, text_pos));
 }
 
-vbo &rect_norm_vbo()
+void quad_type::draw(render_target &target) const
 {
-	static vbo res = make_rect_vbo();
+	detail::vao_lock vlock;
+	detail::cull_face_lock clock;
+	detail::fbo_lock flock;
+
+	detail::state().set_enabled(GL_CULL_FACE, false);
+
+	bind_target(target);
+
+	m_vao.use();
+	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+}
+
+quad_type &quad_type::get_instance()
+{
+	static quad_type res;
 	return res;
 }
 
-const vbo &rect_textPos_vbo()
+mat4 quad_model(const mat4 &model, vec3 right, vec3 up, vec2 size)
 {
-	// assumes that the other vbo's follow this convection: min, right, max, up
-	static shape_data_array<4, 2> text_coords{ {
-		{0, 0},
-		{1, 0},
-		{1, 1},
-		{0, 1},
-	}};
-	static vbo buffer = text_coords.get_buffer();
-	return buffer;
+	// the z column only orients the normal, the quad has no depth
+	mat4 res = model;
+	post_linear(res, mat3{size.x * right, size.y * up, normalize(cross(right, up))});
+	return res;
 }
 
 // const vbo& rect_data_2d()
@@ -112,7 +155,7 @@ const vbo &rect_textPos_vbo()
 
 const vbo &cube_texture_coords()
 {
-	static shape_data_array<3 * 12, 2> text_coords{ {
+	static constexpr shape_data_array<3 * 12, 2> text_coords{ {
 			// FRONT FACE
 			{0, 0}, {1, 0}, {0, 1},
 			{0, 1}, {1, 0}, {1, 1},
@@ -161,7 +204,7 @@ const vbo &cube_norms()
 	constexpr vec3 left_norm = cross(D - A, D - H);
 	constexpr vec3 right_norm = cross(B - C, B - F);
 
-	static shape_data_array<3 * 12, 3> norms{ {
+	static constexpr shape_data_array<3 * 12, 3> norms{ {
 			// FRONT FACE
 			front_norm, front_norm, front_norm,
 			front_norm, front_norm, front_norm,
@@ -203,7 +246,7 @@ const vbo &cube_pts()
 	constexpr vec3 G(-.5, .5, .5);
 	constexpr vec3 H(.5, .5, .5);
 
-	static shape_data_array<3 * 12, 3> pts{ {
+	static constexpr shape_data_array<3 * 12, 3> pts{ {
 			// FRONT FACE
 			A, B, E,
 			E, B, F,
@@ -3,6 +3,10 @@
 #include "object/buffers.h"
 #include "shaders/render_shader.h"
 #include "object/shape_data.h"
+#include "object/render_obj.h"
+#include "math/bound.h"
+
+#include <cstdint>
 
 SGL_BEG
 DETAIL_BEG
@@ -10,9 +14,48 @@ void setup_shader(render_shader &program, const mat4 &m, const lighting_engine *
 
 const mat4 &identity_ref();
 
-vbo &rect_obj_vbo();
-vbo &rect_norm_vbo();
-const vbo &rect_textPos_vbo();
+// std140 layout of the sgl_Camera block
+struct camera_data
+{
+	mat4 view;
+	mat4 proj;
+	mat4 view_proj;
+	vec4 position;
+};
+
+// camera of the current projection and view, recomputed only when either has changed
+const camera_data &get_camera();
+
+// incremented every time the camera is recomputed
+std::uint64_t camera_version();
+
+// bind the camera uniform buffer to render_shader::camera_binding, uploading the camera first if it changed
+void bind_camera();
+
+// true if frustum culling is enabled and local (in model space) is fully outside the current view frustum
+bool is_culled(const bound &local, const mat4 &model);
+
+// unit quad (0, 0, 0), (1, 0, 0), (1, 1, 0), (0, 1, 0) facing -z, shared by rectangle_obj, sprite, point_obj<2> and text.
+// Size and orientation of each object are put in the model matrix, so drawing never writes to a buffer
+class quad_type : public rendervao_type
+{
+public:
+	quad_type();
+
+	void draw(render_target &target) const override;
+
+	static quad_type &get_instance();
+
+private:
+	vbo m_buffer;
+};
+
+// local bounds of quad_type
+constexpr bound quad_bound{{0, 0, 0}, {1, 1, 0}};
+
+// model * (transform of the unit quad onto the rectangle spanned by size.x * right and size.y * up)
+// right and up are unit vectors
+mat4 quad_model(const mat4 &model, vec3 right, vec3 up, vec2 size);
 
 // const vbo &rect_data_2d();
 
@@ -0,0 +1,106 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SGL_BEG
+DETAIL_BEG
+
+mapped_file::~mapped_file()
+{
+	close();
+}
+
+#ifdef _WIN32
+bool mapped_file::open(const std::string &file_name)
+{
+	close();
+
+	HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	// the mapping keeps the file open, its handle isn't needed anymore
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapping)
+		return false;
+
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+
+	m_data = static_cast<const unsigned char *>(view);
+	m_size = static_cast<std::size_t>(size.QuadPart);
+	m_handle = mapping;
+	return true;
+}
+
+void mapped_file::close()
+{
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_handle)
+		CloseHandle(m_handle);
+
+	m_data = nullptr;
+	m_size = 0;
+	m_handle = nullptr;
+}
+#else
+bool mapped_file::open(const std::string &file_name)
+{
+	close();
+
+	int fd = ::open(file_name.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) || info.st_size <= 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	void *view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED)
+		return false;
+
+	m_data = static_cast<const unsigned char *>(view);
+	m_size = static_cast<std::size_t>(info.st_size);
+	return true;
+}
+
+void mapped_file::close()
+{
+	if (m_data)
+		munmap(const_cast<unsigned char *>(m_data), m_size);
+
+	m_data = nullptr;
+	m_size = 0;
+}
+#endif
+
+DETAIL_END
+SGL_END
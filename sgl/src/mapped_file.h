@@ -0,0 +1,35 @@
+#pragma once
+#include "macro.h"
+
+#include <string>
+#include <cstddef>
+
+SGL_BEG
+DETAIL_BEG
+
+// read only memory mapping of a whole file
+class mapped_file
+{
+public:
+	inline mapped_file() : m_data{}, m_size{}, m_handle{} {}
+	~mapped_file();
+
+	mapped_file(const mapped_file &) = delete;
+	mapped_file &operator=(const mapped_file &) = delete;
+
+	// false if the file doesn't exist, is empty, or can't be mapped. Doesn't log errors
+	bool open(const std::string &file_name);
+	void close();
+
+	inline const unsigned char *data() const { return m_data; }
+	inline std::size_t size() const { return m_size; }
+
+private:
+	const unsigned char *m_data;
+	std::size_t m_size;
+	// the file mapping object on windows, unused elsewhere
+	void *m_handle;
+};
+
+DETAIL_END
+SGL_END
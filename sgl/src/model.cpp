@@ -104,11 +104,33 @@ model_data::mesh process_mesh(const std::vector<model_data::material_type> &mate
 
 	res.material = materials.data() + mesh->mMaterialIndex;
 
+	if (mesh->mNumVertices)
+	{
+		vec3 min = res.vertices.front().pos;
+		vec3 max = min;
+		for (const auto &v : res.vertices)
+			for (vec_len i = 0; i < 3; ++i)
+			{
+				min[i] = std::min(min[i], v.pos[i]);
+				max[i] = std::max(max[i], v.pos[i]);
+			}
+		res.aabb = {min, max - min};
+	}
+
 	return res;
 }
 
 void process_node(const std::vector<model_data::mesh> &meshes, model_data::node &cur, aiNode *node)
 {
+	// assimp matrices are row major
+	const aiMatrix4x4 &t = node->mTransformation;
+	cur.transform = {
+		vec4{t.a1, t.b1, t.c1, t.d1},
+		vec4{t.a2, t.b2, t.c2, t.d2},
+		vec4{t.a3, t.b3, t.c3, t.d3},
+		vec4{t.a4, t.b4, t.c4, t.d4},
+	};
+
 	cur.meshes.resize(node->mNumMeshes);
 	for (unsigned int i = 0; i < node->mNumMeshes; ++i)
 		cur.meshes[i] = meshes.data() + node->mMeshes[i];
@@ -214,17 +236,26 @@ texture &default_specular()
 	return res;
 }
 
+template <bool scalable, bool rotatable>
+render_shader *mesh_obj<scalable, rotatable>::default_shader() const
+{
+	return &model_detail::get_shader();
+}
+
 template <bool scalable, bool rotatable>
 void mesh_obj<scalable, rotatable>::draw(render_target &target, const render_settings &settings) const
 {
 	base_transformable_obj::update_model();
 
-	detail::shader_lock slock;
-
-	render_shader &shader = settings.shader ? *settings.shader : model_detail::get_shader();
-
 	const mesh_type *type = dynamic_cast<const mesh_type *>(render_obj::type);
 	auto mesh = type->mesh();
+
+	if (detail::is_culled(mesh->aabb, base_transformable_obj::model))
+		return;
+
+	detail::shader_lock slock;
+
+	render_shader &shader = *render_obj::get_shader(settings);
 	if (mesh->material)
 	{
 		const auto &mmaterial = *mesh->material;
@@ -297,9 +328,38 @@ void model_type::draw(render_target &target) const
 template <bool scalable, bool rotatable>
 model_obj<scalable, rotatable>::model_obj(const model_type &type) : render_obj(type)
 {
-	meshes.reserve(type.m_meshes.size());
+	// mesh_types are stored in the same order as the model's meshes
+	std::vector<const mesh_type *> mesh_types;
+	mesh_types.reserve(type.m_meshes.size());
 	for (const auto &mesh : type.m_meshes)
-		meshes.emplace_back(mesh);
+		mesh_types.push_back(&mesh);
+
+	// the root node of model_obj is the user's handle, the model's root node is attached under it
+	m_nodes.push_back(std::make_unique<scene_node>());
+
+	auto add_node = [&](auto &self, const model_data::node &node, scene_node &parent) -> void
+	{
+		auto &cur = *m_nodes.emplace_back(std::make_unique<scene_node>(node.transform));
+		parent.attach(cur);
+
+		for (const auto *mesh : node.meshes)
+		{
+			auto &obj = meshes.emplace_back(*mesh_types[mesh - type.model()->meshes().data()]);
+			obj.set_parent(&cur);
+		}
+
+		for (const auto &child : node.children)
+			self(self, *child, cur);
+	};
+
+	if (type.model())
+		add_node(add_node, type.model()->root, root());
+}
+
+template <bool scalable, bool rotatable>
+render_shader *model_obj<scalable, rotatable>::default_shader() const
+{
+	return &model_detail::get_shader();
 }
 
 template <bool scalable, bool rotatable>
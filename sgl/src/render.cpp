@@ -1,6 +1,11 @@
 #include "object/render_target.h"
 #include "object/render_obj.h"
 #include "context_lock/context_lock.h"
+#include "help.h"
+#include "utils/error.h"
+
+#include <bit>
+#include <unordered_map>
 
 SGL_BEG
 
@@ -25,6 +30,85 @@ const mat4 *get_view()
 	return view_value;
 }
 
+static bool culling_value = true;
+
+DETAIL_BEG
+
+static detail::camera_data camera_value{identity(), identity(), identity(), {0, 0, 0, 1}};
+static std::uint64_t camera_version_value = 0;
+static std::uint64_t camera_uploaded_version = ~std::uint64_t(0);
+
+const camera_data &get_camera()
+{
+	const mat4 &p = projection_value ? *projection_value : identity_ref();
+	const mat4 &v = view_value ? *view_value : identity_ref();
+
+	// the matrices are held by pointer and may be modified in place, so compare by value
+	if (p != camera_value.proj || v != camera_value.view)
+	{
+		camera_value.proj = p;
+		camera_value.view = v;
+		camera_value.view_proj = p * v;
+		// views are usually rigid (a camera's look at matrix), whose inverse is just a transpose
+		camera_value.position = (is_rigid(v) ? rigid_inverse(v) : inverse(v))[3];
+		++camera_version_value;
+	}
+
+	return camera_value;
+}
+
+std::uint64_t camera_version()
+{
+	get_camera();
+	return camera_version_value;
+}
+
+void bind_camera()
+{
+	static ubo buffer;
+
+	const camera_data &camera = get_camera();
+	if (camera_uploaded_version != camera_version_value)
+	{
+		if (!buffer.index())
+		{
+			buffer.generate();
+			buffer.attach_data(sizeof(camera), &camera, GL_DYNAMIC_DRAW);
+		}
+		else
+			buffer.attach_sub_data(0, sizeof(camera), &camera);
+		camera_uploaded_version = camera_version_value;
+	}
+
+	state().bind_uniform_buffer_base(render_shader::camera_binding, buffer.index());
+}
+
+DETAIL_END
+
+const frustum &get_frustum()
+{
+	static std::uint64_t version = ~std::uint64_t(0);
+	static frustum res(identity());
+
+	const detail::camera_data &camera = detail::get_camera();
+	if (version != detail::camera_version())
+	{
+		version = detail::camera_version();
+		res.set(camera.view_proj);
+	}
+
+	return res;
+}
+
+void set_frustum_culling(bool enabled)
+{
+	culling_value = enabled;
+}
+bool get_frustum_culling()
+{
+	return culling_value;
+}
+
 void render_target::clear(vec4 color, GLbitfield mask)
 {
 	detail::fbo_lock flock;
@@ -49,6 +133,154 @@ void render_target::draw(const render_obj &obj)
 	obj.draw(*this);
 }
 
+namespace render_detail
+{
+	// sort key layout, most significant first:
+	// pass (4) | blended (1) | opaque: shader (10) | material (10) | vao (10) | depth (29)
+	//                        | blended: inverted depth (29) | shader (10) | material (10) | vao (10)
+	constexpr int id_bits = 10;
+	constexpr int depth_bits = 29;
+
+	constexpr std::uint64_t id_mask = (std::uint64_t(1) << id_bits) - 1;
+
+	// small consecutive ids for state pointers, in order of first use
+	class id_map
+	{
+	public:
+		inline std::uint64_t operator()(const void *state)
+		{
+			// nullptr (no shader or material, or a default that isn't known) always sorts first
+			if (!state)
+				return 0;
+			auto it = ids.try_emplace(state, ids.size() + 1).first;
+			return std::min<std::uint64_t>(it->second, id_mask);
+		}
+
+	private:
+		std::unordered_map<const void *, std::uint64_t> ids;
+	};
+
+	// distance in front of the camera quantized to depth_bits, greater is further away
+	std::uint64_t depth_key(const render_obj &obj, const mat4 &view)
+	{
+		auto transformable = dynamic_cast<const base_transformable_obj *>(&obj);
+		if (!transformable)
+			return 0;
+
+		transformable->update_model();
+		const vec4 &pos = transformable->get_model()[3];
+		float dist = -(view[0].z * pos.x + view[1].z * pos.y + view[2].z * pos.z + view[3].z * pos.w);
+
+		// the bits of non negative floats sort the same as their values
+		if (!(dist > 0))
+			return 0;
+		return std::bit_cast<std::uint32_t>(dist) >> (32 - depth_bits - 1);
+	}
+
+	// lsd radix sort on the keys, 8 bits per pass. Passes where every key has the same digit are skipped
+	void radix_sort(std::vector<std::pair<std::uint64_t, std::uint32_t>> &keys, std::vector<std::pair<std::uint64_t, std::uint32_t>> &buffer)
+	{
+		constexpr int passes = sizeof(std::uint64_t);
+
+		std::size_t counts[passes][256]{};
+		for (const auto &k : keys)
+			for (int p = 0; p < passes; ++p)
+				++counts[p][(k.first >> (p * 8)) & 0xff];
+
+		buffer.resize(keys.size());
+		for (int p = 0; p < passes; ++p)
+		{
+			std::size_t *count = counts[p];
+			if (count[(keys.front().first >> (p * 8)) & 0xff] == keys.size())
+				continue;
+
+			std::size_t offset = 0;
+			for (int d = 0; d < 256; ++d)
+				offset += std::exchange(count[d], offset);
+
+			for (const auto &k : keys)
+				buffer[count[(k.first >> (p * 8)) & 0xff]++] = k;
+			keys.swap(buffer);
+		}
+	}
+}
+
+void render_target::submit(const render_obj &obj, const render_settings &settings, bool blended, unsigned int pass)
+{
+	if (pass >= 16)
+	{
+		detail::log_error(error("Render pass must be less than 16.", error_code::invalid_argument));
+		return;
+	}
+	m_queue.push_back({&obj, settings, pass, blended});
+}
+
+void render_target::submit(const render_obj &obj)
+{
+	submit(obj, render_settings(vec4{0, 0, 0, 1}, nullptr, nullptr, nullptr));
+}
+
+void render_target::flush()
+{
+	using namespace render_detail;
+
+	if (m_queue.empty())
+		return;
+
+	const mat4 &view = view_value ? *view_value : detail::identity_ref();
+
+	id_map shader_ids;
+	id_map material_ids;
+	id_map vao_ids;
+
+	m_keys.resize(m_queue.size());
+	for (std::size_t i = 0; i < m_queue.size(); ++i)
+	{
+		const queued_draw &d = m_queue[i];
+		// the shader the draw will bind, so objects drawn with their default shader group too
+		std::uint64_t shader = shader_ids(d.obj->get_shader(d.settings));
+		std::uint64_t material = material_ids(d.settings.material);
+		std::uint64_t vao = vao_ids(d.obj->get_vao());
+		std::uint64_t depth = depth_key(*d.obj, view);
+
+		std::uint64_t key = std::uint64_t(d.pass) << 60 | std::uint64_t(d.blended) << 59;
+		if (d.blended)
+			key |= (~depth & ((std::uint64_t(1) << depth_bits) - 1)) << (3 * id_bits) | shader << (2 * id_bits) | material << id_bits | vao;
+		else
+			key |= shader << (2 * id_bits + depth_bits) | material << (id_bits + depth_bits) | vao << depth_bits | depth;
+
+		m_keys[i] = {key, static_cast<std::uint32_t>(i)};
+	}
+
+	radix_sort(m_keys, m_sort_buffer);
+
+	detail::blend_lock block;
+	bool blending = false;
+	detail::state().set_enabled(GL_BLEND, false);
+
+	for (const auto &k : m_keys)
+	{
+		const queued_draw &d = m_queue[k.second];
+
+		// only change blend state on transitions between opaque and blended runs
+		if (d.blended != blending)
+		{
+			blending = d.blended;
+			if (blending)
+			{
+				detail::state().set_enabled(GL_BLEND, true);
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			}
+			else
+				detail::state().set_enabled(GL_BLEND, false);
+		}
+
+		d.obj->draw(*this, d.settings);
+	}
+
+	m_queue.clear();
+}
+
 ivec2 texture_target::drawable_size() const
 {
 	return { text->get_width(), text->get_height() };
@@ -86,37 +318,44 @@ void render_obj::draw(render_target &target) const
 
 void movable_obj::apply_transform() const
 {
-	model *= translate(m_loc);
+	post_translate(model, m_loc);
 }
 void scalable_obj::apply_transform() const
 {
 	if (m_origin != vec3{})
 	{
-		model *= translate(m_origin);
-		model *= scale(m_scale);
-		model *= translate(-m_origin);
+		post_translate(model, m_origin);
+		post_scale(model, m_scale);
+		post_translate(model, -m_origin);
 	}
 	else
-		model *= scale(m_scale);
+		post_scale(model, m_scale);
 }
 
 void rotatable_obj::apply_transform() const
 {
-	if (m_angle != 0)
+	if (m_rotation.w != 1)
 	{
 		if (m_origin != vec3{})
 		{
-			model *= translate(m_origin);
-			model *= rot(m_angle, m_axis);
-			model *= translate(-m_origin);
+			post_translate(model, m_origin);
+			post_linear(model, rot3x3(m_rotation));
+			post_translate(model, -m_origin);
 		}
 		else
-			model *= rot(m_angle, m_axis);
+			post_linear(model, rot3x3(m_rotation));
 	}
 }
 
 void transformable_obj<true, true, true>::apply_transform() const
 {
+	// without a parent or origins, model starts as identity and ends as a plain trs, built directly
+	if (!get_parent() && scalable_obj::m_origin == vec3{} && rotatable_obj::m_origin == vec3{})
+	{
+		model = trs(m_loc, rot3x3(m_rotation), m_scale);
+		return;
+	}
+
 	movable_obj::apply_transform();
 	rotatable_obj::apply_transform();
 	scalable_obj::apply_transform();
@@ -5,6 +5,8 @@
 #define normal_loc 1
 #define color_loc 2
 #define textPos_loc 3
+#define instanceModel_loc 4
+#define instanceColor_loc 8
 
 #define STR_2(x) #x
 #define STR(x) STR_2(x)
@@ -21,6 +23,15 @@ void render_shader::generate_shader(const std::string &vertex, const std::string
 	std::string frag_src = "#version 410 core\n";
 
 	// uniforms
+	if (has_camera_block())
+	{
+		// the block declares sgl_View and sgl_Proj itself
+		m_variables &= ~(sgl_View | sgl_Proj);
+
+		static const std::string val = "layout (std140) uniform sgl_Camera { mat4 sgl_View; mat4 sgl_Proj; mat4 sgl_ViewProj; vec3 sgl_CameraPos; };";
+		vertex_src += val;
+		frag_src += val;
+	}
 	if (has_color_uniform())
 	{
 		static const std::string val = "uniform vec4 sgl_Color;";
@@ -84,6 +95,26 @@ void render_shader::generate_shader(const std::string &vertex, const std::string
 		(vertex_src += type) += val;
 		(frag_src += type) += val;
 	}
+	if (has_lights_block())
+	{
+		// the block replaces the individual light uniforms
+		m_variables &= ~(sgl_GlobalLight | sgl_DirectionalLights | sgl_PositionalLights | sgl_Spotlights);
+		m_directionals.clear();
+		m_positionals.clear();
+		m_spotlights.clear();
+
+		static const std::string val =
+			"struct sgl_GlobalLight_t { vec3 ambient; };"
+			"struct sgl_DirectionalLight_t { vec3 ambient; vec3 diffuse; vec3 specular; vec3 direction; };"
+			"struct sgl_PositionalLight_t { vec3 ambient; vec3 diffuse; vec3 specular; vec3 position; float constant; float linear; float quadratic; };"
+			"struct sgl_Spotlight_t { vec3 ambient; vec3 diffuse; vec3 specular; vec3 direction; vec3 position; float cutoff_angle; float outer_cutoff_angle; float constant; float linear; float quadratic; };"
+			"layout (std140) uniform sgl_Lights { sgl_GlobalLight_t sgl_GlobalLight; int sgl_DirectionalLightsSize; int sgl_PostionalLightsSize; int sgl_SpotlightsSize;"
+			"sgl_DirectionalLight_t sgl_DirectionalLights[" + std::to_string(lighting_engine::max_directional_lights) + "];"
+			"sgl_PositionalLight_t sgl_PositionalLights[" + std::to_string(lighting_engine::max_positional_lights) + "];"
+			"sgl_Spotlight_t sgl_Spotlights[" + std::to_string(lighting_engine::max_spotlights) + "]; };";
+		vertex_src += val;
+		frag_src += val;
+	}
 	if (has_globalLight_uniform())
 	{
 		static const std::string type = "struct sgl_GlobalLight_t { vec3 ambient; };";
@@ -153,6 +184,17 @@ void render_shader::generate_shader(const std::string &vertex, const std::string
 		vertex_src += val;
 	}
 
+	if (has_instanceModel_attribute())
+	{
+		static const std::string val = "layout (location = " STR(instanceModel_loc) ") in mat4 sgl_InstanceModel;";
+		vertex_src += val;
+	}
+	if (has_instanceColor_attribute())
+	{
+		static const std::string val = "layout (location = " STR(instanceColor_loc) ") in vec4 sgl_InstanceColor;";
+		vertex_src += val;
+	}
+
 	// out/in variables
 	if (has_pos_out_var())
 	{
@@ -189,16 +231,47 @@ void render_shader::generate_shader(const std::string &vertex, const std::string
 	frag_src += fragment;
 
 	m_shader.load_from_memory(vertex_src, frag_src);
+
+	if (has_lights_block())
+	{
+		GLuint block = glGetUniformBlockIndex(m_shader.index(), "sgl_Lights");
+		if (block != GL_INVALID_INDEX)
+			glUniformBlockBinding(m_shader.index(), block, lighting_engine::lights_binding);
+	}
+	if (has_camera_block())
+	{
+		GLuint block = glGetUniformBlockIndex(m_shader.index(), "sgl_Camera");
+		if (block != GL_INVALID_INDEX)
+			glUniformBlockBinding(m_shader.index(), block, camera_binding);
+	}
+
+	// resolve uniform locations once instead of on every set
+	auto resolve = [&]<typename T>(uniform<T> &u, bool included, const char *name) { u = included ? m_shader.get_uniform<T>(name) : uniform<T>(); };
+	resolve(m_color, has_color_uniform(), "sgl_Color");
+	resolve(m_view, has_view_uniform(), "sgl_View");
+	resolve(m_model, has_model_uniform(), "sgl_Model");
+	resolve(m_proj, has_proj_uniform(), "sgl_Proj");
+	resolve(m_modelView, has_modelView_uniform(), "sgl_ModelView");
+	resolve(m_modelViewProj, has_modelViewProj_uniform(), "sgl_ModelViewProj");
+	resolve(m_inverseModelView, has_inverseModelView_uniform(), "sgl_InverseModelView");
+	resolve(m_texture, has_texture_uniform(), "sgl_Texture");
+	resolve(m_directionalsSize, has_directionalLights_uniform(), "sgl_DirectionalLightsSize");
+	resolve(m_positionalsSize, has_positionalLights_uniform(), "sgl_PostionalLightsSize");
+	resolve(m_spotlightsSize, has_spotlights_uniform(), "sgl_SpotlightsSize");
 }
 
 unsigned int render_shader::pos_attribute_loc = pos_loc;
 unsigned int render_shader::normal_attribute_loc = normal_loc;
 unsigned int render_shader::color_attribute_loc = color_loc;
 unsigned int render_shader::textPos_attribute_loc = textPos_loc;
+unsigned int render_shader::instanceModel_attribute_loc = instanceModel_loc;
+unsigned int render_shader::instanceColor_attribute_loc = instanceColor_loc;
+
+unsigned int render_shader::camera_binding = 1;
 
 render_shader phong_shader(unsigned int num_directional, unsigned int num_positional, unsigned int num_spotlights, unsigned int variables)
 {
-	constexpr int includes = variables::sgl_Model | variables::sgl_View | variables::sgl_Proj | variables::sgl_Pos | variables::sgl_Normal | variables::sgl_VertNormal | variables::sgl_InverseModelView;
+	constexpr int includes = variables::sgl_Model | variables::sgl_View | variables::sgl_Proj | variables::sgl_Pos | variables::sgl_Normal | variables::sgl_VertNormal | variables::sgl_InverseModelView | variables::sgl_Lights | variables::sgl_Camera;
 
 	variables |= includes;
 
@@ -266,13 +339,12 @@ render_shader phong_shader(unsigned int num_directional, unsigned int num_positi
 	vertex += 
 		"view_pos = (sgl_View * sgl_Model * vec4(sgl_Pos, 1.0)).xyz;"
 		"sgl_VertNormal = normalize(mat3(transpose(sgl_InverseModelView)) * sgl_Normal);"
-		"gl_Position = sgl_Proj * sgl_View * sgl_Model * vec4(sgl_Pos, 1.0);}";
+		"gl_Position = sgl_ViewProj * sgl_Model * vec4(sgl_Pos, 1.0);}";
 	
 
 	render_shader res;
 	if (num_directional)
 	{
-		res.set_num_directionalLights(num_directional);
 		fragment +=
 			"vec3 calc_directional(int i){"
 
@@ -306,7 +378,6 @@ render_shader phong_shader(unsigned int num_directional, unsigned int num_positi
 
 	if (num_positional)
 	{
-		res.set_num_positionalLights(num_positional);
 		fragment +=
 			"vec3 calc_positional(int i){"
 
@@ -344,7 +415,6 @@ render_shader phong_shader(unsigned int num_directional, unsigned int num_positi
 
 	if (num_spotlights)
 	{
-		res.set_num_spotlights(num_spotlights);
 		fragment +=
 			"vec3 calc_spotlight(int i) {"
 			"vec3 ambient = sgl_Spotlights[i].ambient *";
@@ -388,12 +458,13 @@ render_shader phong_shader(unsigned int num_directional, unsigned int num_positi
 		"void main() {"
 		"vec3 results = vec3(0, 0, 0);";
 
+	// lights come from the sgl_Lights block, the counts given here are upper bounds
 	if (num_directional)
-		fragment += "for (int i = 0; i < sgl_DirectionalLightsSize; ++i) { results += calc_directional(i); }";
+		fragment += "for (int i = 0; i < min(sgl_DirectionalLightsSize, " + std::to_string(num_directional) + "); ++i) { results += calc_directional(i); }";
 	if (num_positional)
-		fragment += "for (int i = 0; i < sgl_PostionalLightsSize; ++i) { results += calc_positional(i); }";
+		fragment += "for (int i = 0; i < min(sgl_PostionalLightsSize, " + std::to_string(num_positional) + "); ++i) { results += calc_positional(i); }";
 	if (num_spotlights)
-		fragment += "for (int i = 0; i < sgl_SpotlightsSize; ++i) { results += calc_spotlight(i); }";
+		fragment += "for (int i = 0; i < min(sgl_SpotlightsSize, " + std::to_string(num_spotlights) + "); ++i) { results += calc_spotlight(i); }";
 
 	fragment += "sgl_OutColor = vec4(results, 1.0); }";
 
@@ -0,0 +1,71 @@
+#include "object/scene.h"
+
+#include <algorithm>
+
+SGL_BEG
+
+scene_node::~scene_node()
+{
+	detach();
+	for (auto child : m_children)
+	{
+		child->m_parent = nullptr;
+		child->mark_dirty();
+	}
+}
+
+void scene_node::attach(scene_node &child)
+{
+	if (child.m_parent == this)
+		return;
+
+	child.detach();
+	child.m_parent = this;
+	m_children.push_back(&child);
+	child.mark_dirty();
+}
+
+void scene_node::detach()
+{
+	if (!m_parent)
+		return;
+
+	auto &siblings = m_parent->m_children;
+	siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+	m_parent = nullptr;
+	mark_dirty();
+}
+
+void scene_node::update() const
+{
+	if (!m_dirty)
+		return;
+
+	recompute();
+	for (auto child : m_children)
+		child->update();
+}
+
+void scene_node::mark_dirty()
+{
+	// descendants of a dirty node are already dirty
+	if (m_dirty)
+		return;
+
+	m_dirty = true;
+	for (auto child : m_children)
+		child->mark_dirty();
+}
+
+void scene_node::recompute() const
+{
+	if (m_parent)
+		m_world = m_parent->get_world() * m_local;
+	else
+		m_world = m_local;
+
+	++m_version;
+	m_dirty = false;
+}
+
+SGL_END
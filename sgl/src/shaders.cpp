@@ -4,6 +4,8 @@
 #include "utils/error.h"
 #include <GL/glew.h>
 
+#include <algorithm>
+
 SGL_BEG
 class shader_source
 {
@@ -142,82 +144,106 @@ void shader::load_from_memory(const std::string &vertex_source, const std::strin
 
 void shader::set_uniform(const std::string &name, float val)
 {
-	detail::shader_lock context;
-	glUseProgram(id);
-	glUniform1f(get_loc(name), val);
+	set_uniform(uniform<float>(get_loc(name)), val);
 }
 void shader::set_uniform(const std::string &name, vec2 val)
 {
-	detail::shader_lock context;
-	glUseProgram(id);
-	glUniform2fv(get_loc(name), 1, value(val));
+	set_uniform(uniform<vec2>(get_loc(name)), val);
 }
 void shader::set_uniform(const std::string &name, vec3 val)
 {
-	detail::shader_lock context;
-	glUseProgram(id);
-	glUniform3fv(get_loc(name), 1, value(val));
+	set_uniform(uniform<vec3>(get_loc(name)), val);
 }
 void shader::set_uniform(const std::string &name, vec4 val)
 {
-	detail::shader_lock context;
-	glUseProgram(id);
-	glUniform4fv(get_loc(name), 1, value(val));
+	set_uniform(uniform<vec4>(get_loc(name)), val);
 }
 
 void shader::set_uniform(const std::string &name, int val)
 {
-	detail::shader_lock context;
-	glUseProgram(id);
-	glUniform1i(get_loc(name), val);
+	set_uniform(uniform<int>(get_loc(name)), val);
 }
 void shader::set_uniform(const std::string &name, ivec2 val)
 {
-	detail::shader_lock context;
-	glUseProgram(id);
-	glUniform2iv(get_loc(name), 1, value(val));
+	set_uniform(uniform<ivec2>(get_loc(name)), val);
 }
 void shader::set_uniform(const std::string &name, ivec3 val)
 {
-	detail::shader_lock context;
-	glUseProgram(id);
-	glUniform3iv(get_loc(name), 1, value(val));
+	set_uniform(uniform<ivec3>(get_loc(name)), val);
 }
 void shader::set_uniform(const std::string &name, ivec4 val)
 {
-	detail::shader_lock context;
-	glUseProgram(id);
-	glUniform4iv(get_loc(name), 1, value(val));
+	set_uniform(uniform<ivec4>(get_loc(name)), val);
 }
 
 void shader::set_uniform(const std::string &name, const mat3 &val)
 {
-	detail::shader_lock context;
-	glUseProgram(id);
-	glUniformMatrix3fv(get_loc(name), 1, GL_FALSE, value(val));
+	set_uniform(uniform<mat3>(get_loc(name)), val);
 }
 void shader::set_uniform(const std::string &name, const mat4 &val)
 {
-	detail::shader_lock context;
-	glUseProgram(id);
-	glUniformMatrix4fv(get_loc(name), 1, GL_FALSE, value(val));
+	set_uniform(uniform<mat4>(get_loc(name)), val);
+}
+
+// glProgramUniform writes to the program directly, so it doesn't need to be bound
+void shader::upload(int loc, float val)
+{
+	glProgramUniform1f(id, loc, val);
+}
+void shader::upload(int loc, vec2 val)
+{
+	glProgramUniform2fv(id, loc, 1, value(val));
+}
+void shader::upload(int loc, vec3 val)
+{
+	glProgramUniform3fv(id, loc, 1, value(val));
+}
+void shader::upload(int loc, vec4 val)
+{
+	glProgramUniform4fv(id, loc, 1, value(val));
+}
+
+void shader::upload(int loc, int val)
+{
+	glProgramUniform1i(id, loc, val);
+}
+void shader::upload(int loc, ivec2 val)
+{
+	glProgramUniform2iv(id, loc, 1, value(val));
+}
+void shader::upload(int loc, ivec3 val)
+{
+	glProgramUniform3iv(id, loc, 1, value(val));
+}
+void shader::upload(int loc, ivec4 val)
+{
+	glProgramUniform4iv(id, loc, 1, value(val));
+}
+
+void shader::upload(int loc, const mat3 &val)
+{
+	glProgramUniformMatrix3fv(id, loc, 1, GL_FALSE, value(val));
+}
+void shader::upload(int loc, const mat4 &val)
+{
+	glProgramUniformMatrix4fv(id, loc, 1, GL_FALSE, value(val));
 }
 
 void shader::set_uniform(const std::string &name, const texture &val)
 {
-	textures[get_loc(name)] = &val;
+	set_uniform(uniform<texture>(get_loc(name)), val);
 }
 
 void shader::bind()
 {
-	glUseProgram(id);
+	detail::state().use_program(id);
 
 	auto it = textures.begin();
 	auto end = textures.end();
 	for (int i = 0; it != end; ++i, ++it)
 	{
 		// send uniform location
-		glUniform1i(it->first, i);
+		set_uniform(uniform<int>(it->first), i);
 		// activate texture
 		texture::activate_unit(i);
 		// bind corresponding texture
@@ -228,41 +254,40 @@ void shader::bind()
 void shader::destroy()
 {
 	glDeleteProgram(id);
+
+	// locations and values belong to the program
+	locations.clear();
+	values.clear();
 }
 
 int shader::get_loc(const std::string &name)
 {
-	return glGetUniformLocation(id, name.c_str());
+	auto it = locations.find(name);
+	if (it == locations.end())
+		it = locations.emplace(name, glGetUniformLocation(id, name.c_str())).first;
+	return it->second;
 }
 
 void material::send(shader &program, const std::string &name) const
 {
-	detail::shader_lock context;
-
-	glUseProgram(program.index());
-
 	std::string member = name + ".ambient";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(ambient));
+	program.set_uniform(member, ambient);
 
 	member = name;
 	member += ".diffuse";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(diffuse));
+	program.set_uniform(member, diffuse);
 
 	member = name;
 	member += ".specular";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(specular));
+	program.set_uniform(member, specular);
 
 	member = name;
 	member += ".shininess";
-	glUniform1f(glGetUniformLocation(program.index(), member.c_str()), shininess);
+	program.set_uniform(member, shininess);
 }
 
 void texture_material::send(shader &program, const std::string &name) const
 {
-	detail::shader_lock context;
-
-	glUseProgram(program.index());
-
 	std::string member;
 	if (diffuse)
 	{
@@ -279,17 +304,13 @@ void texture_material::send(shader &program, const std::string &name) const
 
 	member = name;
 	member += ".shininess";
-	glUniform1f(glGetUniformLocation(program.index(), member.c_str()), shininess);
+	program.set_uniform(member, shininess);
 }
 
 void global_light::send(shader &program, const std::string &name) const
 {
-	detail::shader_lock context;
-
-	glUseProgram(program.index());
-
 	std::string member = name + ".ambient";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(ambient));
+	program.set_uniform(member, ambient);
 }
 
 //void basic_light::send(shader &program, const std::string &name) const
@@ -312,105 +333,210 @@ void global_light::send(shader &program, const std::string &name) const
 
 void directional_light::send(shader &program, const std::string &name) const
 {
-	detail::shader_lock context;
-
-	glUseProgram(program.index());
-
 	std::string member = name + ".ambient";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(ambient));
+	program.set_uniform(member, ambient);
 
 	member = name;
 	member += ".diffuse";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(diffuse));
+	program.set_uniform(member, diffuse);
 
 	member = name;
 	member += ".specular";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(specular));
+	program.set_uniform(member, specular);
 
 	member = name;
 	member += ".direction";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(direction));
+	program.set_uniform(member, direction);
 }
 
 void positional_light::send(shader &program, const std::string &name) const
 {
-	detail::shader_lock context;
-
-	glUseProgram(program.index());
-
 	std::string member = name + ".ambient";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(ambient));
+	program.set_uniform(member, ambient);
 
 	member = name;
 	member += ".diffuse";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(diffuse));
+	program.set_uniform(member, diffuse);
 
 	member = name;
 	member += ".specular";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(specular));
+	program.set_uniform(member, specular);
 
 	member = name;
 	member += ".position";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(position));
+	program.set_uniform(member, position);
 
 	member = name;
 	member += ".constant";
-	glUniform1f(glGetUniformLocation(program.index(), member.c_str()), constant);
+	program.set_uniform(member, constant);
 
 	member = name;
 	member += ".linear";
-	glUniform1f(glGetUniformLocation(program.index(), member.c_str()), linear);
+	program.set_uniform(member, linear);
 
 	member = name;
 	member += ".quadratic";
-	glUniform1f(glGetUniformLocation(program.index(), member.c_str()), quadratic);
+	program.set_uniform(member, quadratic);
 }
 
 void spotlight::send(shader &program, const std::string &name) const
 {
-	detail::shader_lock context;
-
-	glUseProgram(program.index());
-
 	std::string member = name + ".ambient";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(ambient));
+	program.set_uniform(member, ambient);
 
 	member = name;
 	member += ".diffuse";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(diffuse));
+	program.set_uniform(member, diffuse);
 
 	member = name;
 	member += ".specular";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(specular));
+	program.set_uniform(member, specular);
 
 	member = name;
 	member += ".direction";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(direction));
+	program.set_uniform(member, direction);
 
 	member = name;
 	member += ".position";
-	glUniform3fv(glGetUniformLocation(program.index(), member.c_str()), 1, value(position));
+	program.set_uniform(member, position);
 
 	member = name;
 	member += ".cutoff_angle";
-	glUniform1f(glGetUniformLocation(program.index(), member.c_str()), cutoff_angle);
+	program.set_uniform(member, cutoff_angle);
 
 
 	member = name;
 	member += ".outer_cutoff_angle";
-	glUniform1f(glGetUniformLocation(program.index(), member.c_str()), outer_cutoff_angle);
+	program.set_uniform(member, outer_cutoff_angle);
 
 	member = name;
 	member += ".constant";
-	glUniform1f(glGetUniformLocation(program.index(), member.c_str()), constant);
+	program.set_uniform(member, constant);
 
 	member = name;
 	member += ".linear";
-	glUniform1f(glGetUniformLocation(program.index(), member.c_str()), linear);
+	program.set_uniform(member, linear);
 
 	member = name;
 	member += ".quadratic";
-	glUniform1f(glGetUniformLocation(program.index(), member.c_str()), quadratic);
+	program.set_uniform(member, quadratic);
+}
+
+namespace lighting_detail
+{
+	// std140 layouts of the light structs in the sgl_Lights block, vec3s are aligned to 16 bytes
+	struct directional_std140
+	{
+		vec3 ambient; float pad0;
+		vec3 diffuse; float pad1;
+		vec3 specular; float pad2;
+		vec3 direction; float pad3;
+	};
+
+	struct positional_std140
+	{
+		vec3 ambient; float pad0;
+		vec3 diffuse; float pad1;
+		vec3 specular; float pad2;
+		vec3 position; float constant;
+		float linear; float quadratic; float pad3[2];
+	};
+
+	struct spotlight_std140
+	{
+		vec3 ambient; float pad0;
+		vec3 diffuse; float pad1;
+		vec3 specular; float pad2;
+		vec3 direction; float pad3;
+		vec3 position; float cutoff_angle;
+		float outer_cutoff_angle; float constant; float linear; float quadratic;
+	};
+
+	struct lights_std140
+	{
+		vec3 global_ambient; float pad0;
+		int directional_size;
+		int positional_size;
+		int spotlights_size;
+		int pad1;
+		directional_std140 directionals[lighting_engine::max_directional_lights];
+		positional_std140 positionals[lighting_engine::max_positional_lights];
+		spotlight_std140 spotlights[lighting_engine::max_spotlights];
+	};
+
+	static_assert(sizeof(directional_std140) == 64 && sizeof(positional_std140) == 80 && sizeof(spotlight_std140) == 96, "light layouts must match std140");
+}
+
+unsigned int lighting_engine::lights_binding = 0;
+
+void lighting_engine::upload() const
+{
+	using namespace lighting_detail;
+
+	lights_std140 data{};
+
+	if (m_has_global)
+		data.global_ambient = m_global.ambient;
+
+	data.directional_size = static_cast<int>(std::min(m_directional.size(), max_directional_lights));
+	for (int i = 0; i < data.directional_size; ++i)
+	{
+		const auto &l = m_directional[i];
+		auto &d = data.directionals[i];
+		d.ambient = l.ambient;
+		d.diffuse = l.diffuse;
+		d.specular = l.specular;
+		d.direction = l.direction;
+	}
+
+	data.positional_size = static_cast<int>(std::min(m_positional.size(), max_positional_lights));
+	for (int i = 0; i < data.positional_size; ++i)
+	{
+		const auto &l = m_positional[i];
+		auto &d = data.positionals[i];
+		d.ambient = l.ambient;
+		d.diffuse = l.diffuse;
+		d.specular = l.specular;
+		d.position = l.position;
+		d.constant = l.constant;
+		d.linear = l.linear;
+		d.quadratic = l.quadratic;
+	}
+
+	data.spotlights_size = static_cast<int>(std::min(m_spotlight.size(), max_spotlights));
+	for (int i = 0; i < data.spotlights_size; ++i)
+	{
+		const auto &l = m_spotlight[i];
+		auto &d = data.spotlights[i];
+		d.ambient = l.ambient;
+		d.diffuse = l.diffuse;
+		d.specular = l.specular;
+		d.direction = l.direction;
+		d.position = l.position;
+		d.cutoff_angle = l.cos_cutoff_angle();
+		d.outer_cutoff_angle = l.cos_outer_cutoff_angle();
+		d.constant = l.constant;
+		d.linear = l.linear;
+		d.quadratic = l.quadratic;
+	}
+
+	if (!m_buffer.index())
+	{
+		m_buffer.generate();
+		m_buffer.attach_data(sizeof(data), &data, GL_DYNAMIC_DRAW);
+	}
+	else
+		m_buffer.attach_sub_data(0, sizeof(data), &data);
+
+	m_changed = false;
+}
+
+void lighting_engine::bind() const
+{
+	if (m_changed)
+		upload();
+
+	detail::state().bind_uniform_buffer_base(lights_binding, m_buffer.index());
 }
 
 SGL_END
\ No newline at end of file
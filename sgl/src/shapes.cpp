@@ -18,6 +18,15 @@ namespace shapes_detail
 		return shader;
 	}
 
+	render_shader &get_instanced_shader()
+	{
+		using namespace variables;
+		static std::string vertex_source = "void main() { gl_Position = sgl_ModelViewProj * sgl_InstanceModel * vec4(sgl_Pos, 1.0); sgl_VertColor = sgl_InstanceColor; }";
+		static std::string fragment_source = "void main() { sgl_OutColor = sgl_VertColor; }";
+		static render_shader shader(vertex_source, fragment_source, sgl_ModelViewProj | sgl_Pos | sgl_InstanceModel | sgl_InstanceColor | sgl_VertColor);
+		return shader;
+	}
+
 	vao make_shape_vao(const vbo &points, const vbo &normals, const vbo &text_points, vec_len dim)
 	{
 		detail::vao_lock lvao;
@@ -42,6 +51,9 @@ namespace shapes_detail
 
 		return res;
 	}
+
+	// local bounds of cube_type, shared by cube_obj, point_obj<3> and line_obj
+	constexpr bound cube_bound{{-.5f, -.5f, -.5f}, {1, 1, 1}};
 }
 
 class cube_type : public rendervao_type
@@ -82,6 +94,9 @@ void cube_obj<rotatable>::draw(render_target& target) const
 {
 	base_transformable_obj::update_model();
 
+	if (detail::is_culled(shapes_detail::cube_bound, base_transformable_obj::model))
+		return;
+
 	detail::shader_lock slock;
 
 	detail::setup_shader(shapes_detail::get_shader(), base_transformable_obj::model, nullptr, nullptr, nullptr, {0, 0, 0, 1});
@@ -89,52 +104,35 @@ void cube_obj<rotatable>::draw(render_target& target) const
 	render_obj::type->draw(target);
 }
 
+template <bool rotatable>
+render_shader *cube_obj<rotatable>::default_shader() const
+{
+	return &shapes_detail::get_shader();
+}
+
 template <bool rotatable>
 void cube_obj<rotatable>::draw(render_target &target, const render_settings &settings) const
 {
 	base_transformable_obj::update_model();
 
+	if (detail::is_culled(shapes_detail::cube_bound, base_transformable_obj::model))
+		return;
+
 	detail::shader_lock slock;
 
-	render_shader &shader = settings.shader ? *settings.shader : shapes_detail::get_shader();
+	render_shader &shader = *render_obj::get_shader(settings);
 	detail::setup_shader(shader, base_transformable_obj::model, settings.engine, nullptr, settings.material, settings.color);
 
 	render_obj::type->draw(target);
 }
 
-class rectangle_type : public rendervao_type
-{
-public:
-	rectangle_type() : rendervao_type(shapes_detail::make_shape_vao(detail::rect_obj_vbo(), detail::rect_norm_vbo(), detail::rect_textPos_vbo(), 3)) {}
-
-	void draw(render_target& target) const override
-	{
-		detail::vao_lock vlock;
-		detail::cull_face_lock clock;
-		detail::fbo_lock flock;
-
-		glDisable(GL_CULL_FACE);
-
-		bind_target(target);
-
-		m_vao.use();
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-	}
-
-	static rectangle_type& get_instance()
-	{
-		static rectangle_type res;
-		return res;
-	}
-};
-
 template <bool rotatable>
-rectangle_obj<rotatable>::rectangle_obj() : render_obj(rectangle_type::get_instance())
+rectangle_obj<rotatable>::rectangle_obj() : render_obj(detail::quad_type::get_instance())
 {
 }
 
 template <bool rotatable>
-rectangle_obj<rotatable>::rectangle_obj(vec3 min, vec2 size, vec3 right, vec3 up) : render_obj(rectangle_type::get_instance()), movable_obj(min),
+rectangle_obj<rotatable>::rectangle_obj(vec3 min, vec2 size, vec3 right, vec3 up) : render_obj(detail::quad_type::get_instance()), movable_obj(min),
 																					m_right{normalize(right)}, m_up{normalize(up)}, m_sz{size}
 {
 }
@@ -144,56 +142,48 @@ void rectangle_obj<rotatable>::draw(render_target& target) const
 {
 	base_transformable_obj::update_model();
 
+	mat4 model = quad_model();
+	if (detail::is_culled(detail::quad_bound, model))
+		return;
+
 	detail::shader_lock slock;
 
-	setup_buffer();
-	
-	detail::setup_shader(shapes_detail::get_shader(), base_transformable_obj::model, nullptr, nullptr, nullptr, { 0, 0, 0, 1 });
+	detail::setup_shader(shapes_detail::get_shader(), model, nullptr, nullptr, nullptr, { 0, 0, 0, 1 });
 
 	render_obj::type->draw(target);
 }
 
+template <bool rotatable>
+render_shader *rectangle_obj<rotatable>::default_shader() const
+{
+	return &shapes_detail::get_shader();
+}
+
 template <bool rotatable>
 void rectangle_obj<rotatable>::draw(render_target &target, const render_settings &settings) const
 {
 	base_transformable_obj::update_model();
 
-	detail::shader_lock slock;
+	mat4 model = quad_model();
+	if (detail::is_culled(detail::quad_bound, model))
+		return;
 
-	setup_buffer();
+	detail::shader_lock slock;
 
-	render_shader &shader = settings.shader ? *settings.shader : shapes_detail::get_shader();
-	detail::setup_shader(shader, base_transformable_obj::model, settings.engine, nullptr, settings.material, settings.color);
+	render_shader &shader = *render_obj::get_shader(settings);
+	detail::setup_shader(shader, model, settings.engine, nullptr, settings.material, settings.color);
 
 	render_obj::type->draw(target);
 }
 
 template <bool rotatable>
-void rectangle_obj<rotatable>::setup_buffer() const
+mat4 rectangle_obj<rotatable>::quad_model() const
 {
-	auto pos_vbo = render_obj::get_vao()->get_attribute(render_shader::pos_attribute_loc);
-
-	auto data = pos_vbo. template get_data<vec3>(GL_WRITE_ONLY);
-	vec3 right = m_sz.x * m_right;
-	vec3 up = m_sz.y * m_up;
-	data[0] = {};
-	data[1] = right;
-	data[2] = right + up;
-	data[3] = up;
-
-	auto norm_vbo = render_obj::get_vao()->get_attribute(render_shader::normal_attribute_loc);
-	auto norm = normalize(cross(right, -up));
-	
-	// test to see which is faster
-	vec3 norm_array[4] = { norm, norm, norm, norm };
-	norm_vbo.attach_data(norm_array, GL_DYNAMIC_DRAW);
-
-	/*auto norm_data = norm_vbo. template get_data<vec3>(GL_WRITE_ONLY);
-	norm_data[0] = norm_data[1] = norm_data[2] = norm_data[3] = norm;*/
+	return detail::quad_model(base_transformable_obj::model, m_right, m_up, m_sz);
 }
 
 template <>
-point_obj<2>::point_obj(vec2 center, float size) : render_obj(rectangle_type::get_instance()), m_center{ center }, m_size{ size }
+point_obj<2>::point_obj(vec2 center, float size) : render_obj(detail::quad_type::get_instance()), m_center{ center }, m_size{ size }
 {
 }
 
@@ -203,41 +193,17 @@ point_obj<3>::point_obj(vec3 center, float size) : render_obj(cube_type::get_ins
 }
 
 template <vec_len dim>
-point_obj<dim>::point_obj() : render_obj(rectangle_type::get_instance()), m_center{}, m_size { 1 }
+point_obj<dim>::point_obj() : render_obj(detail::quad_type::get_instance()), m_center{}, m_size { 1 }
 {
 }
 
 template <>
 void point_obj<2>::apply_transform() const
 {
-	model *= translate(vec3(m_center));
-}
-
-void point_obj_2_setup_buffer(float half, const vao &_vao)
-{
-	auto v = _vao.get_attribute(render_shader::pos_attribute_loc);
-
-	auto data = v. template get_data<vec3>(GL_WRITE_ONLY);
-
-	/*vec3 min(-half, -half, 0);
-	vec3 right(half, -half, 0);
-	vec3 max(half, half, 0);
-	vec3 up(-half, half, 0);*/
-	data[0] = { -half, -half, 0 };
-	data[1] = { half, -half, 0 };
-	data[2] = { half,  half, 0 };
-	data[3] = { -half,  half, 0 };
-
-	auto norm_vbo = _vao.get_attribute(render_shader::normal_attribute_loc);
-
-	// cross(right - min, right - max);
-	// cross((half, -half) - (-half, -half), (half, -half) - (half, half));
-	// cross((2 * half, 0), (0, -2 * half))
-	auto norm = normalize(cross(vec3(2 * half, 0, 0), vec3(0, -2 * half)));
-
-	// test to see which is faster
-	vec3 norm_array[4] = { norm, norm, norm, norm };
-	norm_vbo.attach_data(norm_array, GL_DYNAMIC_DRAW);
+	// the unit quad is centered on m_center and scaled to m_size
+	post_translate(model, vec3(m_center));
+	post_scale(model, vec3(m_size, m_size, 1));
+	post_translate(model, vec3(-.5f, -.5f, 0));
 }
 
 
@@ -246,25 +212,33 @@ void point_obj<2>::draw(render_target& target) const
 {
 	base_transformable_obj::update_model();
 
-	detail::shader_lock slock;
+	if (detail::is_culled(detail::quad_bound, base_transformable_obj::model))
+		return;
 
-	point_obj_2_setup_buffer(m_size / 2, *render_obj::get_vao());
+	detail::shader_lock slock;
 
 	detail::setup_shader(shapes_detail::get_shader(), base_transformable_obj::model, nullptr, nullptr, nullptr, { 0, 0, 0, 1 });
 
 	render_obj::type->draw(target);
 }
 
+template <vec_len dim>
+render_shader *point_obj<dim>::default_shader() const
+{
+	return &shapes_detail::get_shader();
+}
+
 template <>
 void point_obj<2>::draw(render_target &target, const render_settings &settings) const
 {
 	base_transformable_obj::update_model();
 
-	detail::shader_lock slock;
+	if (detail::is_culled(detail::quad_bound, base_transformable_obj::model))
+		return;
 
-	point_obj_2_setup_buffer(m_size / 2, *render_obj::get_vao());
+	detail::shader_lock slock;
 
-	render_shader &shader = settings.shader ? *settings.shader : shapes_detail::get_shader();
+	render_shader &shader = *render_obj::get_shader(settings);
 	detail::setup_shader(shader, base_transformable_obj::model, settings.engine, nullptr, nullptr, settings.color);
 
 	render_obj::type->draw(target);
@@ -274,8 +248,8 @@ template <>
 void point_obj<3>::apply_transform() const
 {
 	vec3 size(m_size, m_size, m_size);
-	model *= translate(m_center);
-	model *= scale(size);
+	post_translate(model, m_center);
+	post_scale(model, size);
 }
 
 template <>
@@ -283,6 +257,9 @@ void point_obj<3>::draw(render_target& target) const
 {
 	base_transformable_obj::update_model();
 
+	if (detail::is_culled(shapes_detail::cube_bound, base_transformable_obj::model))
+		return;
+
 	detail::shader_lock slock;
 
 	detail::setup_shader(shapes_detail::get_shader(), base_transformable_obj::model, nullptr, nullptr, nullptr, { 0, 0, 0, 1 });
@@ -295,9 +272,12 @@ void point_obj<3>::draw(render_target &target, const render_settings &settings)
 {
 	base_transformable_obj::update_model();
 
+	if (detail::is_culled(shapes_detail::cube_bound, base_transformable_obj::model))
+		return;
+
 	detail::shader_lock slock;
 
-	render_shader &shader = settings.shader ? *settings.shader : shapes_detail::get_shader();
+	render_shader &shader = *render_obj::get_shader(settings);
 	detail::setup_shader(shader, base_transformable_obj::model, settings.engine, nullptr, settings.material, settings.color);
 
 	render_obj::type->draw(target);
@@ -319,6 +299,9 @@ void line_obj<scalable, rotatable>::draw(render_target& target) const
 {
 	base_transformable_obj::update_model();
 
+	if (detail::is_culled(shapes_detail::cube_bound, base_transformable_obj::model))
+		return;
+
 	detail::shader_lock lock;
 
 	detail::setup_shader(shapes_detail::get_shader(), base_transformable_obj::model, nullptr, nullptr, nullptr, { 0, 0, 0, 1 });
@@ -326,14 +309,23 @@ void line_obj<scalable, rotatable>::draw(render_target& target) const
 	render_obj::type->draw(target);
 }
 
+template <bool scalable, bool rotatable>
+render_shader *line_obj<scalable, rotatable>::default_shader() const
+{
+	return &shapes_detail::get_shader();
+}
+
 template <bool scalable, bool rotatable>
 void line_obj<scalable, rotatable>::draw(render_target &target, const render_settings &settings) const
 {
 	base_transformable_obj::update_model();
 
+	if (detail::is_culled(shapes_detail::cube_bound, base_transformable_obj::model))
+		return;
+
 	detail::shader_lock lock;
 
-	render_shader &shader = settings.shader ? *settings.shader : shapes_detail::get_shader();
+	render_shader &shader = *render_obj::get_shader(settings);
 	detail::setup_shader(shader, base_transformable_obj::model, settings.engine, nullptr, settings.material, settings.color);
 
 	render_obj::type->draw(target);
@@ -352,9 +344,78 @@ void line_obj<scalable, rotatable>::apply_transform() const
 
 	vec3 scalef{m_width, diff_mag, m_width};
 	
-	base_transformable_obj::model *= translate(movable_obj::m_loc + diff / 2);
-	base_transformable_obj::model *= rot(angle, axis);
-	base_transformable_obj::model *= scale(scalef);
+	post_translate(base_transformable_obj::model, movable_obj::m_loc + diff / 2);
+	post_linear(base_transformable_obj::model, rot3x3(angle, axis));
+	post_scale(base_transformable_obj::model, scalef);
+}
+
+cube_batch::cube_batch() : render_obj(), m_vao{shapes_detail::make_shape_vao(detail::cube_pts(), detail::cube_norms(), detail::cube_texture_coords(), 3)}, m_capacity{}, m_changed{true}
+{
+	detail::vao_lock lvao;
+	detail::vbo_lock lvbo;
+
+	m_buffer.generate();
+
+	m_vao.use();
+	m_buffer.use();
+
+	// one vec4 attribute per column of the model matrix
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		unsigned int loc = render_shader::instanceModel_attribute_loc + i;
+		glEnableVertexAttribArray(loc);
+		glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, sizeof(instance), (void *)(i * sizeof(vec4)));
+		glVertexAttribDivisor(loc, 1);
+	}
+
+	glEnableVertexAttribArray(render_shader::instanceColor_attribute_loc);
+	glVertexAttribPointer(render_shader::instanceColor_attribute_loc, 4, GL_FLOAT, GL_FALSE, sizeof(instance), (void *)sizeof(mat4));
+	glVertexAttribDivisor(render_shader::instanceColor_attribute_loc, 1);
+}
+
+void cube_batch::upload() const
+{
+	if (m_instances.size() > m_capacity)
+	{
+		// grow geometrically so adding a few instances a frame doesn't reallocate every time
+		m_capacity = std::max(m_instances.size(), m_capacity * 2);
+		m_buffer.reserve_data(m_capacity * sizeof(instance), GL_DYNAMIC_DRAW);
+	}
+
+	m_buffer.attach_sub_data(0, m_instances.size() * sizeof(instance), m_instances.data());
+	m_changed = false;
+}
+
+render_shader *cube_batch::default_shader() const
+{
+	return &shapes_detail::get_instanced_shader();
+}
+
+void cube_batch::draw(render_target &target, const render_settings &settings) const
+{
+	if (m_instances.empty())
+		return;
+
+	if (m_changed)
+		upload();
+
+	detail::shader_lock slock;
+	detail::vao_lock vlock;
+	detail::fbo_lock flock;
+
+	render_shader &shader = *get_shader(settings);
+	detail::setup_shader(shader, detail::identity_ref(), settings.engine, nullptr, settings.material, settings.color);
+
+	bind_target(target);
+
+	m_vao.use();
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 36, static_cast<GLsizei>(m_instances.size()));
+}
+
+void cube_batch::draw(render_target &target) const
+{
+	render_settings settings({0, 0, 0, 1}, nullptr, nullptr, nullptr);
+	draw(target, settings);
 }
 
 template class rectangle_obj<false>;
@@ -9,6 +9,8 @@
 
 #include "help.h"
 
+#include <algorithm>
+
 SGL_BEG
 
 namespace sprite_detail
@@ -23,59 +25,8 @@ namespace sprite_detail
 	}
 }
 
-class sprite_type : public rendervao_type
-{
-public:
-	sprite_type() : rendervao_type()
-	{
-		detail::vao_lock lvao;
-		detail::vbo_lock lvbo;
-		
-		m_vao.generate();
-		m_vao.use();
-
-		static sgl::shape_data_array<4, 2> text_pts_data = {
-			{
-				{0, 0},
-				{1, 0},
-				{1, 1},
-				{0, 1},
-			}};
-
-		static auto text_pts_buffer = text_pts_data.get_buffer();
-
-		detail::rect_obj_vbo().use();
-		glEnableVertexAttribArray(render_shader::pos_attribute_loc);
-		glVertexAttribPointer(render_shader::pos_attribute_loc, 3, GL_FLOAT, GL_FALSE, 0, (void *)0);
-
-		text_pts_buffer.use();
-		glEnableVertexAttribArray(render_shader::textPos_attribute_loc);
-		glVertexAttribPointer(render_shader::textPos_attribute_loc, 2, GL_FLOAT, GL_FALSE, 0, (void *)0);
-	}
-
-	void draw(render_target &target) const override
-	{
-		detail::vao_lock vlock;
-		detail::cull_face_lock clock;
-		detail::fbo_lock flock;
-
-		glDisable(GL_CULL_FACE);
-
-		bind_target(target);
-
-		m_vao.use();
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-	}
-
-	static sprite_type& get_instance()
-	{
-		static sprite_type res;
-		return res;
-	}
-};
-
 template <bool rotatable>
-sprite<rotatable>::sprite(const texture &texture, vec3 min, vec2 size, vec3 right, vec3 up) : render_obj(sprite_type::get_instance()),
+sprite<rotatable>::sprite(const texture &texture, vec3 min, vec2 size, vec3 right, vec3 up) : render_obj(detail::quad_type::get_instance()),
 																							   movable_obj(min),
 																							   rectangle_obj<rotatable>::rectangle_obj(min, size, right, up),
 																							   m_texture(&texture)
@@ -89,13 +40,17 @@ void sprite<rotatable>::draw(render_target &target) const
 
 	detail::shader_lock vlock;
 
-	rectangle_obj<rotatable>::setup_buffer();
-
-	detail::setup_shader(sprite_detail::get_shader(), base_transformable_obj::model, nullptr, m_texture, nullptr, {0, 0, 0, 1});
+	detail::setup_shader(sprite_detail::get_shader(), rectangle_obj<rotatable>::quad_model(), nullptr, m_texture, nullptr, {0, 0, 0, 1});
 
 	render_obj::type->draw(target);
 }
 
+template <bool rotatable>
+render_shader *sprite<rotatable>::default_shader() const
+{
+	return &sprite_detail::get_shader();
+}
+
 template <bool rotatable>
 void sprite<rotatable>::draw(render_target &target, const render_settings &settings) const
 {
@@ -103,10 +58,8 @@ void sprite<rotatable>::draw(render_target &target, const render_settings &setti
 
 	detail::shader_lock vlock;
 
-	rectangle_obj<rotatable>::setup_buffer();
-
-	render_shader &shader = settings.shader ? *settings.shader : sprite_detail::get_shader();
-	detail::setup_shader(shader, base_transformable_obj::model, settings.engine, m_texture, settings.material, { 0, 0, 0, 1 });
+	render_shader &shader = *render_obj::get_shader(settings);
+	detail::setup_shader(shader, rectangle_obj<rotatable>::quad_model(), settings.engine, m_texture, settings.material, { 0, 0, 0, 1 });
 
 	render_obj::type->draw(target);
 }
@@ -114,4 +67,127 @@ void sprite<rotatable>::draw(render_target &target, const render_settings &setti
 template class sprite<false>;
 template class sprite<true>;
 
+sprite_batch::sprite_batch() : render_obj(), m_index_capacity{}, m_changed{true}
+{
+	detail::ebo_lock lebo;
+	detail::vao_lock lvao;
+	detail::vbo_lock lvbo;
+
+	m_vertices.generate();
+	m_indices.generate();
+
+	m_vao.generate();
+	m_vao.use();
+
+	m_vertices.use();
+	glEnableVertexAttribArray(render_shader::pos_attribute_loc);
+	glVertexAttribPointer(render_shader::pos_attribute_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void *)offsetof(vertex, pos));
+
+	glEnableVertexAttribArray(render_shader::textPos_attribute_loc);
+	glVertexAttribPointer(render_shader::textPos_attribute_loc, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void *)offsetof(vertex, text_pos));
+
+	m_indices.use();
+}
+
+void sprite_batch::add(const texture &texture, const mat4 &model, vec3 right, vec3 up, vec2 text_min, vec2 text_max)
+{
+	vec3 origin(model[3]);
+	vec3 r(model * vec4(right, 0));
+	vec3 u(model * vec4(up, 0));
+
+	m_quads.push_back({&texture, {
+		{origin, text_min},
+		{origin + r, {text_max.x, text_min.y}},
+		{origin + r + u, text_max},
+		{origin + u, {text_min.x, text_max.y}},
+	}});
+	m_changed = true;
+}
+
+void sprite_batch::upload() const
+{
+	// sort by texture so each texture is drawn once, keeping the order quads were added in within a texture
+	m_order.resize(m_quads.size());
+	for (std::size_t i = 0; i < m_order.size(); ++i)
+		m_order[i] = i;
+	std::stable_sort(m_order.begin(), m_order.end(), [&](std::size_t a, std::size_t b) { return m_quads[a].text < m_quads[b].text; });
+
+	m_ranges.clear();
+	m_staging.resize(m_quads.size() * 4);
+	for (std::size_t i = 0; i < m_order.size(); ++i)
+	{
+		const quad &q = m_quads[m_order[i]];
+		std::copy(std::begin(q.vertices), std::end(q.vertices), m_staging.begin() + i * 4);
+
+		if (m_ranges.empty() || m_ranges.back().text != q.text)
+			m_ranges.push_back({q.text, i, 0});
+		++m_ranges.back().count;
+	}
+
+	// orphan the old storage so the driver doesn't wait on draws still using it
+	m_vertices.reserve_data(m_staging.size() * sizeof(vertex), GL_STREAM_DRAW);
+	m_vertices.attach_sub_data(m_staging);
+
+	// indices are the same for every batch, only rebuilt when more quads are needed
+	if (m_quads.size() > m_index_capacity)
+	{
+		m_index_capacity = std::max(m_quads.size(), m_index_capacity * 2);
+
+		std::vector<GLuint> indices(m_index_capacity * 6);
+		for (std::size_t i = 0; i < m_index_capacity; ++i)
+		{
+			GLuint v = static_cast<GLuint>(i * 4);
+			GLuint *idx = indices.data() + i * 6;
+			idx[0] = v;
+			idx[1] = v + 1;
+			idx[2] = v + 2;
+			idx[3] = v;
+			idx[4] = v + 2;
+			idx[5] = v + 3;
+		}
+
+		// m_indices is already attached to m_vao, binding m_vao here would let the buffer's lock unbind it
+		m_indices.attach_data(indices, GL_STATIC_DRAW);
+	}
+
+	m_changed = false;
+}
+
+render_shader *sprite_batch::default_shader() const
+{
+	return &sprite_detail::get_shader();
+}
+
+void sprite_batch::draw(render_target &target, const render_settings &settings) const
+{
+	if (m_quads.empty())
+		return;
+
+	if (m_changed)
+		upload();
+
+	detail::shader_lock slock;
+	detail::vao_lock vlock;
+	detail::cull_face_lock clock;
+	detail::fbo_lock flock;
+
+	detail::state().set_enabled(GL_CULL_FACE, false);
+
+	bind_target(target);
+	m_vao.use();
+
+	render_shader &shader = *render_obj::get_shader(settings);
+	for (const auto &r : m_ranges)
+	{
+		detail::setup_shader(shader, detail::identity_ref(), settings.engine, r.text, settings.material, {0, 0, 0, 1});
+		glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(r.count * 6), GL_UNSIGNED_INT, (void *)(r.first * 6 * sizeof(GLuint)));
+	}
+}
+
+void sprite_batch::draw(render_target &target) const
+{
+	render_settings settings({0, 0, 0, 1}, nullptr, nullptr, nullptr);
+	draw(target, settings);
+}
+
 SGL_END
@@ -0,0 +1,141 @@
+#include "object/stream_buffer.h"
+#include "context_lock/context_lock.h"
+#include "utils/error.h"
+
+SGL_BEG
+
+namespace stream_buffer_detail
+{
+	// rounded up, so an allocation ending at the end of the ring is still in the last region
+	GLsizeiptr region_size(GLsizeiptr size, unsigned int regions)
+	{
+		GLsizeiptr count = static_cast<GLsizeiptr>(regions ? regions : 1);
+		return (size + count - 1) / count;
+	}
+}
+
+stream_buffer::stream_buffer(GLsizeiptr size, unsigned int regions) : m_size{size}, m_region_size{stream_buffer_detail::region_size(size, regions)}, m_offset{},
+																	  m_region{}, m_fences(regions ? regions : 1, nullptr), m_mapped{}, m_persistent{}, m_needs_unmap{}
+{
+	detail::vbo_lock lock;
+
+	m_buffer.generate();
+	m_buffer.use();
+
+	if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+	{
+		constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, m_size, nullptr, flags);
+		m_mapped = static_cast<unsigned char *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, m_size, flags));
+		m_persistent = m_mapped != nullptr;
+
+		// storage is immutable, so the fallback's glBufferData needs a fresh buffer
+		if (!m_persistent)
+		{
+			m_buffer.generate();
+			m_buffer.use();
+		}
+	}
+
+	if (!m_persistent)
+		glBufferData(GL_ARRAY_BUFFER, m_size, nullptr, GL_STREAM_DRAW);
+}
+
+stream_buffer::~stream_buffer()
+{
+	for (auto fence : m_fences)
+		if (fence)
+			glDeleteSync(fence);
+
+	if (m_persistent || m_needs_unmap)
+	{
+		detail::vbo_lock lock;
+		m_buffer.use();
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+}
+
+void *stream_buffer::allocate_bytes(GLsizeiptr size, GLsizeiptr alignment, GLintptr &offset)
+{
+	if (size > m_region_size)
+	{
+		detail::log_error(error("Stream buffer allocation is larger than a region.", error_code::invalid_argument));
+		offset = 0;
+		return nullptr;
+	}
+
+	// round up so offset is a whole number of elements
+	offset = (m_offset + alignment - 1) / alignment * alignment;
+
+	bool wrap = offset + size > m_size;
+	if (wrap)
+		offset = 0;
+
+	if (m_persistent)
+	{
+		// move through every region up to the one the allocation ends in, waiting for the gpu to release it
+		unsigned int last = static_cast<unsigned int>((offset + size - 1) / m_region_size);
+		if (wrap || last != m_region)
+			enter_region(last);
+	}
+
+	m_offset = offset + size;
+
+	if (m_persistent)
+		return m_mapped + offset;
+
+	detail::vbo_lock lock;
+	m_buffer.use();
+
+	// orphan the old storage instead of waiting for draws that are still reading it
+	if (wrap)
+		glBufferData(GL_ARRAY_BUFFER, m_size, nullptr, GL_STREAM_DRAW);
+
+	if (m_needs_unmap)
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+
+	// nothing in flight reads this range since the last orphan, so there is nothing to synchronize with
+	void *res = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	m_needs_unmap = res != nullptr;
+	return res;
+}
+
+void stream_buffer::commit()
+{
+	// the persistent mapping is coherent, writes are visible without flushing
+	if (!m_needs_unmap)
+		return;
+
+	detail::vbo_lock lock;
+	m_buffer.use();
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+	m_needs_unmap = false;
+}
+
+void stream_buffer::enter_region(unsigned int region)
+{
+	unsigned int count = static_cast<unsigned int>(m_fences.size());
+	do
+	{
+		// every draw reading the region being left has been issued
+		m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_region = (m_region + 1) % count;
+
+		GLsync &fence = m_fences[m_region];
+		if (fence)
+		{
+			GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+			while (true)
+			{
+				GLenum res = glClientWaitSync(fence, flags, 1000000);
+				if (res != GL_TIMEOUT_EXPIRED)
+					break;
+				flags = 0;
+			}
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	} while (m_region != region);
+}
+
+SGL_END
@@ -5,37 +5,21 @@
 #include "object/buffers.h"
 #include "shaders/shaders.h"
 
-#include "object/sprite.h"
+#include "object/stream_buffer.h"
 
 #include "utils/error.h"
 
 #include "help.h"
+#include "glyph_rasterizer.h"
 
-#include <stdexcept>
 #include <algorithm>
-
-#include <ft2build.h>
-#include FT_FREETYPE_H
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <vector>
 
 SGL_BEG
 
-DETAIL_BEG
-struct library_handle
-{
-	FT_Library library;
-
-	library_handle() : library{}
-	{
-		if (FT_Init_FreeType(&library))
-			detail::log_error(error("Could not initialize freetype.", error_code::freetype_initialization_failure));
-	}
-	~library_handle()
-	{
-		FT_Done_FreeType(library);
-	}
-};
-DETAIL_END
-
 detail::library_handle &get_library()
 {
 	static detail::library_handle lib;
@@ -81,86 +65,230 @@ void font::face_handle::resize()
 	FT_Set_Pixel_Sizes(face, 0, size);
 }
 
-void font::load(const std::string &file_name, unsigned int height)
+// pages fit any glyph of the font, which can be taller than the pixel height
+int atlas_page_size(unsigned int height)
+{
+	return std::max(glyph_atlas::default_page_size, static_cast<int>(std::bit_ceil(4 * height)));
+}
+
+std::size_t budget_pages(std::size_t bytes, int page_size)
+{
+	std::size_t page_bytes = static_cast<std::size_t>(page_size) * page_size;
+	return std::max<std::size_t>(1, bytes / page_bytes);
+}
+
+font::font() = default;
+font::~font() = default;
+
+font::font(font &&other) noexcept = default;
+font &font::operator=(font &&other) noexcept = default;
+
+void font::reset(unsigned int height, glyph_mode mode)
+{
+	// bitmaps still being rasterized are for the old face
+	m_rasterizer.reset();
+	m_requested.clear();
+
+	m_mode = mode;
+	face.size = height;
+	++m_metrics_version;
+	clear_glyphs();
+}
+
+void font::clear_glyphs()
 {
 	m_chars.clear();
-	
+	m_flat_loaded.reset();
+
+	int page_size = atlas_page_size(face.size);
+	std::size_t max_pages = m_budget == unlimited_budget ? glyph_atlas::unlimited_pages : budget_pages(m_budget, page_size);
+	// distance fields are meant to be interpolated between texels
+	m_atlas = glyph_atlas(page_size, m_mode == glyph_mode::sdf ? GL_LINEAR : GL_NEAREST, max_pages);
+	++m_version;
+}
+
+void font::set_cache_budget(std::size_t bytes)
+{
+	m_budget = bytes;
+	m_atlas.set_max_pages(bytes == unlimited_budget ? glyph_atlas::unlimited_pages : budget_pages(bytes, m_atlas.page_size()));
+}
+
+int font::glyph_padding() const
+{
+	return m_mode == glyph_mode::sdf ? detail::sdf_spread : 0;
+}
+
+void font::place_glyph(const unsigned char *bitmap, int width, int height, int pitch, glyph_atlas::region &res) const
+{
+	if (m_atlas.add(bitmap, width, height, pitch, res))
+		return;
+
+	unsigned int page = m_atlas.evict(m_clock);
+	if (page == glyph_atlas::no_page)
+	{
+		// every page has glyphs of the text being laid out, reusing one would draw the wrong glyphs
+		m_atlas.add(bitmap, width, height, pitch, res, true);
+		return;
+	}
+
+	// forget every glyph on the evicted page, they are loaded again when next used
+	for (uint32_t c = 0; c < flat_count; ++c)
+		if (m_flat_loaded[c] && m_flat[c].region.page == page && m_flat[c].region.size.x)
+			m_flat_loaded[c] = false;
+
+	std::erase_if(m_chars, [page](const auto &entry) { return entry.second.region.page == page && entry.second.region.size.x; });
+
+	// cached layouts may reference the evicted glyphs
+	++m_version;
+
+	m_atlas.add(bitmap, width, height, pitch, res);
+}
+
+void font::load(const std::string &file_name, unsigned int height, glyph_mode mode)
+{
+	reset(height, mode);
+
 	face.load(get_library(), file_name);
 
 	face.size = height;
 	face.resize();
+	load_metrics();
+
+	m_file_name = file_name;
+	m_data = nullptr;
+	m_data_size = 0;
+	start_workers();
 }
 
-void font::load(const void *data, std::size_t size, unsigned int height)
+void font::load(const void *data, std::size_t size, unsigned int height, glyph_mode mode)
 {
-	m_chars.clear();
+	reset(height, mode);
 
 	face.load(get_library(), data, size);
 	
 	face.size = height;
 	face.resize();
-}
+	load_metrics();
 
-font::character::character(const font *_font, uint32_t c) : text{}, offset{}, advance{}, height{}
-{
-	load(_font, c);
+	m_file_name.clear();
+	m_data = data;
+	m_data_size = size;
+	start_workers();
 }
 
-font::character::character(character &&other) noexcept : text{std::move(other.text)}, offset{other.offset}, advance{other.advance}, height{other.height}
+void font::load_metrics()
 {
-	other.offset = {};
-	other.height = {};
-	other.advance = {};
+	if (!face.face)
+	{
+		m_line_height = m_ascender = m_descender = 0;
+		return;
+	}
+
+	// 26.6 fixed point
+	const FT_Size_Metrics &metrics = face.face->size->metrics;
+	m_line_height = static_cast<int>(metrics.height >> 6);
+	m_ascender = static_cast<int>(metrics.ascender >> 6);
+	m_descender = static_cast<int>(metrics.descender >> 6);
 }
 
-font::character &font::character::operator=(font::character &&other) noexcept
+void font::start_workers()
 {
-	text.destroy();
+	m_rasterizer.reset();
+	m_requested.clear();
 
-	text = std::move(other.text);
-	offset = other.offset;
-	advance = other.advance;
-	height = other.height;
+	if (m_worker_count && face.face)
+		m_rasterizer = std::make_unique<detail::glyph_rasterizer>(detail::font_source{m_file_name, m_data, m_data_size}, face.size, m_mode == glyph_mode::sdf, m_worker_count);
+}
 
-	other.offset = {};
-	other.height = {};
-	other.advance = {};
+void font::set_worker_count(unsigned int count)
+{
+	if (count == m_worker_count)
+		return;
 
-	return *this;
+	m_worker_count = count;
+	start_workers();
 }
 
-void font::character::load(const font *_font, uint32_t c)
+void font::prewarm(uint32_t first, uint32_t last, bool wait)
 {
-	height = _font->get_character_height();
+	if (!face.face)
+		return;
+
+	for (uint32_t c = first; c <= last && c >= first; ++c)
+		if (!find(c))
+			load_character(c, !m_rasterizer);
 
-	FT_Face face = _font->face.face;
-	if (FT_Load_Char(face, c, FT_LOAD_RENDER))
+	if (m_rasterizer && wait)
 	{
-		detail::log_error(error("Couldn't load character", error_code::freetype_invalid_character));
-		return;
+		m_rasterizer->wait();
+		poll();
 	}
-	text.load(GL_RGBA, face->glyph->bitmap.buffer, face->glyph->bitmap.width, face->glyph->bitmap.rows, 1);
-	offset.x = face->glyph->bitmap_left;
-	offset.y = face->glyph->bitmap_top;
-	advance = face->glyph->advance.x;
+}
 
-	text.set_parameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-	text.set_parameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-	text.set_parameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	text.set_parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+font::character const *font::load_character(uint32_t c, bool wait) const
+{
+	if (m_rasterizer && !wait)
+	{
+		static const character pending = []
+		{
+			character res;
+			res.pending = true;
+			return res;
+		}();
 
-	static vec4 transparent{0, 0, 0, 0};
+		if (m_requested.insert(c).second)
+			m_rasterizer->request(c);
+		return &pending;
+	}
 
-	text.set_parameter(GL_TEXTURE_BORDER_COLOR, value(transparent));
+	detail::glyph_bitmap glyph;
+	detail::rasterize(face.face, c, m_mode == glyph_mode::sdf, glyph);
+	return store(glyph);
 }
 
-font::character::character(const font::character &other)
+font::character const *font::store(const detail::glyph_bitmap &glyph) const
 {
-	throw std::runtime_error("You shouldn't be able to get here... For some reason the copy constructor was called for character");
+	character res;
+	res.height = face.size;
+
+	if (glyph.ok)
+	{
+		place_glyph(glyph.pixels.data(), glyph.width, glyph.rows, glyph.width, res.region);
+		res.offset = glyph.offset;
+		res.advance = glyph.advance;
+	}
+	else
+		detail::log_error(error("Couldn't load character", error_code::freetype_invalid_character));
+
+	if (glyph.c < flat_count)
+	{
+		m_flat[glyph.c] = res;
+		m_flat_loaded[glyph.c] = true;
+		return &m_flat[glyph.c];
+	}
+
+	return &(m_chars[glyph.c] = res);
 }
-font::character &font::character::operator=(const font::character &other)
+
+void font::poll() const
 {
-	throw std::runtime_error("You shouldn't be able to get here... For some reason the copy assignment was called for character");
+	if (!m_rasterizer)
+		return;
+
+	std::vector<detail::glyph_bitmap> ready;
+	m_rasterizer->take(ready);
+	if (ready.empty())
+		return;
+
+	for (const auto &glyph : ready)
+	{
+		m_requested.erase(glyph.c);
+		// the glyph may have been rasterized on this thread while the worker was busy with it
+		if (!find(glyph.c))
+			store(glyph);
+	}
+
+	++m_arrivals;
 }
 
 namespace text_detail
@@ -174,232 +302,699 @@ namespace text_detail
 		return shader;
 	}
 
-	class char_type : public rendervao_type
+	render_shader &get_sdf_shader()
+	{
+		using namespace variables;
+		static std::string vertex_source = "void main() { gl_Position = sgl_ModelViewProj * vec4(sgl_Pos, 1.0); sgl_VertTextPos = sgl_TextPos; }";
+		// the outline is at .5, smoothing over one screen pixel keeps edges sharp at any scale
+		static std::string fragment_source = "void main() { float dist = texture(sgl_Texture, sgl_VertTextPos).r; float w = fwidth(dist); "
+											 "sgl_OutColor = vec4(sgl_Color.xyz, sgl_Color.w * smoothstep(.5 - w, .5 + w, dist)); }";
+		static render_shader shader(vertex_source, fragment_source, sgl_ModelViewProj | sgl_Pos | sgl_TextPos | sgl_VertTextPos | sgl_Color | sgl_Texture);
+		return shader;
+	}
+
+	using vertex = detail::glyph_vertex;
+
+	// most quads drawn in one call, more glyphs on one page are drawn in several
+	constexpr std::size_t max_quads = 16384;
+
+	// glyph quads of every text are streamed through one buffer, drawn with a shared index buffer
+	class glyph_stream
 	{
 	public:
-		char_type() : rendervao_type()
+		glyph_stream() : m_stream(3 * max_quads * 4 * sizeof(vertex))
 		{
+			std::vector<GLuint> indices(max_quads * 6);
+			for (std::size_t i = 0; i < max_quads; ++i)
+			{
+				GLuint v = static_cast<GLuint>(i * 4);
+				GLuint *idx = indices.data() + i * 6;
+				idx[0] = v;
+				idx[1] = v + 1;
+				idx[2] = v + 2;
+				idx[3] = v;
+				idx[4] = v + 2;
+				idx[5] = v + 3;
+			}
+
+			detail::ebo_lock lebo;
 			detail::vao_lock lvao;
 			detail::vbo_lock lvbo;
 
+			m_indices.generate();
+
 			m_vao.generate();
 			m_vao.use();
 
-			static sgl::shape_data_array<4, 2> text_pts_data = {
-			{
-				{0, 0},
-				{1, 0},
-				{1, 1},
-				{0, 1},
-			}};
-
-			static auto text_pts_buffer = text_pts_data.get_buffer();
-
-			detail::rect_obj_vbo().use();
+			m_stream.buffer().use();
 			glEnableVertexAttribArray(render_shader::pos_attribute_loc);
-			glVertexAttribPointer(render_shader::pos_attribute_loc, 3, GL_FLOAT, GL_FALSE, 0, (void *)0);
+			glVertexAttribPointer(render_shader::pos_attribute_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void *)offsetof(vertex, pos));
 
-			text_pts_buffer.use();
 			glEnableVertexAttribArray(render_shader::textPos_attribute_loc);
-			glVertexAttribPointer(render_shader::textPos_attribute_loc, 2, GL_FLOAT, GL_FALSE, 0, (void *)0);
+			glVertexAttribPointer(render_shader::textPos_attribute_loc, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void *)offsetof(vertex, text_pos));
+
+			m_indices.use();
+			m_indices.attach_data(indices, GL_STATIC_DRAW);
 		}
 
-		void draw(render_target &target) const override
+		// draw quads (4 vertices each), call after the shader and target are set up
+		void draw(const vertex *vertices, std::size_t quads) const
 		{
-			detail::vao_lock vlock;
-			detail::fbo_lock flock;
-
-			bind_target(target);
+			detail::vao_lock lock;
 
 			m_vao.use();
-			glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+
+			for (std::size_t i = 0; i < quads; i += max_quads)
+			{
+				std::size_t count = std::min(max_quads, quads - i);
+
+				GLint first;
+				vertex *data = m_stream.allocate<vertex>(count * 4, first);
+				if (!data)
+					return;
+
+				std::copy(vertices + i * 4, vertices + (i + count) * 4, data);
+				m_stream.commit();
+
+				glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(count * 6), GL_UNSIGNED_INT, nullptr, first);
+			}
 		}
 
-		static char_type& get_instance()
+		static glyph_stream &get_instance()
 		{
-			static char_type res;
+			static glyph_stream res;
 			return res;
 		}
+
+	private:
+		mutable stream_buffer m_stream;
+		vao m_vao;
+		ebo m_indices;
 	};
+}
 
-	class char_obj : public rectangle_obj<true>
+void text::invalidate(std::size_t pos, std::size_t unchanged, std::ptrdiff_t shift) const
+{
+	if (m_paragraph)
 	{
-	public:
-		char_obj(vec3 min, vec2 size, vec3 right, vec3 up) : render_obj(char_type::get_instance()),
-															 movable_obj(min),
-												   			 rectangle_obj<true>::rectangle_obj(min, size, right, up),
-															 m_texture{}
+		invalidate_lines(pos, unchanged, shift);
+		return;
+	}
+
+	if (pos >= m_layout.size())
+		return;
+
+	m_layout.resize(pos);
+	if (pos <= m_first_pending)
+		m_first_pending = npos;
+
+	if (pos < m_bounds_count)
+	{
+		m_bounds_count = 0;
+		m_min_y = m_max_y = 0;
+	}
+
+	// vertices are grouped by page, so they can't be truncated at a character
+	if (pos < m_vertex_count)
+		invalidate_vertices();
+}
+
+void text::invalidate_vertices() const
+{
+	for (auto &page : m_vertices)
+		page.clear();
+	m_vertex_count = 0;
+	m_vertex_first_line = m_vertex_last_line = npos;
+}
+
+void text::invalidate_lines(std::size_t pos, std::size_t unchanged, std::ptrdiff_t shift) const
+{
+	invalidate_vertices();
+
+	if (m_lines.empty())
+	{
+		m_lines_complete = false;
+		m_first_pending = npos;
+		return;
+	}
+
+	// the line containing pos can change, and so can the one before it, since removed characters can make room for the next word.
+	// If pos is past the wrapped lines, the last one can still change, its break depends on the word after it
+	auto it = std::upper_bound(m_lines.begin(), m_lines.end(), pos, [](std::size_t p, const line_info &line) { return p < line.begin; });
+	std::size_t first = static_cast<std::size_t>(it - m_lines.begin());
+	first = first > 1 ? first - 2 : 0;
+
+	// a line broken inside a word holds the rest of the word the line before it couldn't fit, which pos can shorten
+	if (m_paragraph->wrap == wrap_mode::word)
+		while (first > 0 && m_lines[first].end == m_lines[first].next)
+			--first;
+
+	// where an old line starts now, lines from old on start in the unchanged part
+	auto moved = [shift](std::size_t index) { return static_cast<std::size_t>(static_cast<std::ptrdiff_t>(index) + shift); };
+	std::size_t old = m_lines.size();
+	if (unchanged != npos && m_font)
+	{
+		old = first + 1;
+		while (old < m_lines.size() && static_cast<std::ptrdiff_t>(m_lines[old].begin) + shift < static_cast<std::ptrdiff_t>(unchanged))
+			++old;
+	}
+
+	std::size_t begin = first ? m_lines[first - 1].next : 0;
+	if (m_first_pending != npos && m_first_pending >= begin)
+		m_first_pending = old < m_lines.size() ? begin : npos;
+
+	// wrap until the new breaks line up with an old line, every line after it is wrapped the same as before.
+	// Without old lines to line up with, wrapping the rest is left to update_lines
+	std::vector<line_info> wrapped;
+	while (old < m_lines.size())
+	{
+		line_info line = wrap_line(begin, false);
+		wrapped.push_back(line);
+		if (is_last_line(line))
 		{
+			m_lines.resize(first);
+			m_lines.insert(m_lines.end(), wrapped.begin(), wrapped.end());
+			m_lines_complete = true;
+			return;
 		}
+		begin = line.next;
 
-		void draw(render_target& target) const override
+		// old lines starting inside the new one can't line up with it
+		while (old < m_lines.size() && moved(m_lines[old].begin) < begin)
+			++old;
+
+		if (old < m_lines.size() && moved(m_lines[old].begin) == begin)
 		{
-			base_transformable_obj::update_model();
+			for (std::size_t i = old; i < m_lines.size(); ++i)
+			{
+				m_lines[i].begin = moved(m_lines[i].begin);
+				m_lines[i].end = moved(m_lines[i].end);
+				m_lines[i].next = moved(m_lines[i].next);
+			}
+
+			auto lines_begin = m_lines.begin() + static_cast<std::ptrdiff_t>(first);
+			m_lines.insert(m_lines.erase(lines_begin, lines_begin + static_cast<std::ptrdiff_t>(old - first)), wrapped.begin(), wrapped.end());
+			return;
+		}
+	}
+
+	m_lines.resize(first);
+	m_lines.insert(m_lines.end(), wrapped.begin(), wrapped.end());
+	m_lines_complete = false;
+}
 
-			detail::cull_face_lock clock;
-			detail::shader_lock slock;
+void text::update_layout(bool exact) const
+{
+	m_font->poll();
 
-			rectangle_obj<true>::setup_buffer();
+	if (m_font->version() != m_font_version)
+	{
+		m_font_version = m_font->version();
+		m_font_arrivals = m_font->arrivals();
+		invalidate(0);
+	}
+	else if (m_font->arrivals() != m_font_arrivals)
+	{
+		// glyphs that were drawn as gaps may have arrived
+		m_font_arrivals = m_font->arrivals();
+		invalidate(m_first_pending);
+	}
 
-			glDisable(GL_CULL_FACE);
+	if (exact)
+		invalidate(m_first_pending);
 
-			detail::setup_shader(text_detail::get_shader(), base_transformable_obj::model, nullptr, m_texture, nullptr, {0, 0, 0, 1});
+	std::size_t first = m_layout.size();
+	if (first >= m_data.size())
+		return;
+
+	// glyphs looked up from here on can't be evicted until the next layout
+	++m_font->m_clock;
+	// neither can the glyphs already laid out, their quads would show whatever replaced them
+	touch_pages(first);
 
-			render_obj::type->draw(target);
+	// remove first character's horizontal offset, so its outline starts at 0
+	float pen = first ? m_layout.back().pen + m_layout.back().advance : 0;
+	if (!first)
+	{
+		const font::character *front = m_font->at(m_data.front(), exact);
+		pen = -static_cast<float>(front->offset.x + (front->region.size.x ? m_font->glyph_padding() : 0));
+	}
+
+	m_layout.reserve(m_data.size());
+	for (std::size_t i = first; i < m_data.size(); ++i)
+	{
+		const font::character *cur = m_font->at(m_data[i], exact);
+		if (cur->pending && m_first_pending == npos)
+			m_first_pending = i;
+
+		glyph_layout g;
+		g.pen = pen;
+		g.advance = static_cast<float>(cur->advance >> 6);
+		g.min = {pen + cur->offset.x, static_cast<float>(cur->offset.y - cur->region.size.y)};
+		g.region = cur->region;
+		m_layout.push_back(g);
+
+		pen += g.advance;
+	}
+}
+
+void text::touch_pages(std::size_t end) const
+{
+	for (unsigned int page = 0; page < m_vertices.size(); ++page)
+		if (!m_vertices[page].empty())
+			m_font->m_atlas.touch(page, m_font->m_clock);
+
+	// characters laid out but not turned into quads yet
+	for (std::size_t i = m_vertex_count; i < end; ++i)
+		if (m_layout[i].region.size.x)
+			m_font->m_atlas.touch(m_layout[i].region.page, m_font->m_clock);
+}
+
+void text::update_bounds() const
+{
+	// the bounds cover the glyph outlines, not the padding around their bitmaps
+	float padding = static_cast<float>(m_font->glyph_padding());
+	for (; m_bounds_count < m_layout.size(); ++m_bounds_count)
+	{
+		const glyph_layout &g = m_layout[m_bounds_count];
+		float pad = g.region.size.x ? padding : 0;
+		m_min_y = std::min(m_min_y, g.min.y + pad);
+		m_max_y = std::max(m_max_y, g.min.y + g.region.size.y - pad);
+	}
+}
+
+float text::layout_right() const
+{
+	const glyph_layout &last = m_layout.back();
+	return last.min.x + last.region.size.x - (last.region.size.x ? m_font->glyph_padding() : 0);
+}
+
+void text::update_vertices() const
+{
+	for (; m_vertex_count < m_layout.size(); ++m_vertex_count)
+		push_glyph(m_layout[m_vertex_count].min, m_layout[m_vertex_count].region);
+}
+
+void text::push_glyph(vec2 min, const glyph_atlas::region &r) const
+{
+	// whitespace has nothing to draw
+	if (r.size.x == 0 || r.size.y == 0)
+		return;
+
+	if (r.page >= m_vertices.size())
+		m_vertices.resize(r.page + 1);
+
+	vec3 loc = m_origin + min.x * m_scale.x * m_dir + min.y * m_scale.y * m_up;
+	vec3 right = r.size.x * m_scale.x * m_dir;
+	vec3 up = r.size.y * m_scale.y * m_up;
+
+	auto &page = m_vertices[r.page];
+	page.push_back({loc, r.text_min});
+	page.push_back({loc + right, {r.text_max.x, r.text_min.y}});
+	page.push_back({loc + right + up, r.text_max});
+	page.push_back({loc + up, {r.text_min.x, r.text_max.y}});
+}
+
+text::line_info text::wrap_line(std::size_t begin, bool exact) const
+{
+	const paragraph_layout &layout = *m_paragraph;
+	bool wrap = layout.wrap != wrap_mode::none && layout.max_width > 0;
+	float limit = layout.max_width / m_scale.x;
+
+	line_info res{begin, m_data.size(), m_data.size(), 0};
+
+	float pen = 0;
+	// start of the current run of spaces and the width before it
+	std::size_t space = npos;
+	float space_width = 0;
+	// last place the line can be broken between words: end of the previous word, its width, and the start of the next one
+	std::size_t word_end = npos;
+	std::size_t word_next = npos;
+	float word_width = 0;
+
+	for (std::size_t i = begin; i < m_data.size(); ++i)
+	{
+		uint32_t c = m_data[i];
+		if (c == '\n')
+		{
+			res.end = i;
+			res.next = i + 1;
+			return res;
+		}
+
+		bool is_space = c == ' ' || c == '\t';
+		if (is_space)
+		{
+			if (space == npos)
+			{
+				space = i;
+				space_width = res.width;
+			}
+		}
+		else if (space != npos)
+		{
+			// leading spaces aren't a break, it would leave an empty line
+			if (space > begin)
+			{
+				word_end = space;
+				word_width = space_width;
+				word_next = i;
+			}
+			space = npos;
 		}
 
-		void draw(render_target &target, const render_settings &settings) const override
+		const font::character *cur = m_font->at(c, exact);
+		if (cur->pending && i < m_first_pending)
+			m_first_pending = i;
+		float advance = static_cast<float>(cur->advance >> 6);
+
+		// spaces hang past the width instead of starting a new line
+		if (wrap && !is_space && i > begin && pen + advance > limit)
 		{
-			base_transformable_obj::update_model();
+			if (layout.wrap == wrap_mode::word && word_next != npos)
+			{
+				res.end = word_end;
+				res.next = word_next;
+				res.width = word_width;
+			}
+			else
+				res.end = res.next = i;
+
+			return res;
+		}
 
-			detail::cull_face_lock clock;
-			detail::shader_lock slock;
+		pen += advance;
+		if (!is_space)
+			res.width = pen;
+	}
 
-			rectangle_obj<true>::setup_buffer();
+	return res;
+}
 
-			glDisable(GL_CULL_FACE);
-		
-			render_shader &shader = settings.shader ? *settings.shader : text_detail::get_shader();
-			detail::setup_shader(shader, base_transformable_obj::model, settings.engine, m_texture, settings.material, { 0, 0, 0, 1 });
+bool text::is_last_line(const line_info &line) const
+{
+	// a text ending with a newline ends with an empty line
+	return line.next >= m_data.size() && (line.next == line.begin || m_data[line.next - 1] != '\n');
+}
 
-			render_obj::type->draw(target);
+void text::update_lines(std::size_t count, bool exact) const
+{
+	while (!m_lines_complete && m_lines.size() < count)
+	{
+		if (m_data.empty())
+		{
+			m_lines_complete = true;
+			break;
 		}
 
-		const texture* m_texture;
-	};
+		line_info line = wrap_line(m_lines.empty() ? 0 : m_lines.back().next, exact);
+		m_lines.push_back(line);
+		m_lines_complete = is_last_line(line);
+	}
 }
 
-void text::draw(render_target &target, const render_settings &settings) const
+void text::update_paragraph(bool exact) const
 {
-	detail::blend_lock lock;
+	m_font->poll();
 
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	if (m_font->metrics_version() != m_font_metrics_version)
+	{
+		m_font_metrics_version = m_font->metrics_version();
+		invalidate(0);
+	}
 
-	auto* cur = m_font->at(m_data.front());
+	if (m_font->version() != m_font_version)
+	{
+		// glyphs may have moved in the atlas, but their advances and so the line breaks are the same
+		m_font_version = m_font->version();
+		invalidate_vertices();
+	}
 
-	// remove first character's horizontal offset
-	auto origin = m_origin - cur->offset.x * m_dir * m_scale.x;
-	text_detail::char_obj cspr({}, {}, m_dir, m_up);
+	if (m_font->arrivals() != m_font_arrivals)
+	{
+		m_font_arrivals = m_font->arrivals();
+		if (m_first_pending != npos)
+			invalidate(m_first_pending);
+		invalidate_vertices();
+	}
 
-	for (uint32_t c : m_data)
+	if (exact && m_first_pending != npos)
+		invalidate(m_first_pending);
+}
+
+void text::update_paragraph_vertices() const
+{
+	float step = line_advance();
+
+	std::size_t first = 0;
+	std::size_t last = npos;
+	if (m_view_height > 0 && step > 0)
 	{
-		cur = m_font->at(c);
+		// a line is visible if any part of it, from its ascender to its descender, is in the region
+		float top = m_view_top / m_scale.y;
+		float bottom = (m_view_top + m_view_height) / m_scale.y;
+		float height = static_cast<float>(m_font->get_ascender() - m_font->get_descender());
+
+		first = top - height > 0 ? static_cast<std::size_t>((top - height) / step) + 1 : 0;
+		last = bottom > 0 ? static_cast<std::size_t>(std::ceil(bottom / step)) : 0;
+	}
 
-		cspr.m_texture = &cur->text;
+	// lines past the region are never wrapped
+	update_lines(last);
+	last = std::min(last, m_lines.size());
+	first = std::min(first, last);
 
-		vec2 sz(cur->text.get_width(), cur->text.get_height());
-		vec3 cur_loc = origin + (cur->offset.x * m_scale.x * m_dir) + ((cur->offset.y - sz.y) * m_scale.y * m_up);
-		origin += (cur->advance >> 6) * m_scale.x * m_dir;
+	if (first == m_vertex_first_line && last == m_vertex_last_line)
+		return;
 
-		cspr.set_loc(cur_loc);
-		cspr.set_size(sz * m_scale);
+	invalidate_vertices();
 
-		cspr.set_angle(m_angle);
-		cspr.set_rot_origin(m_rot_origin - cur_loc);
-		cspr.set_rot_axis(m_axis);
+	// glyphs looked up from here on can't be evicted until the next layout
+	++m_font->m_clock;
 
-		cspr.draw(target, settings);
+	for (std::size_t l = first; l < last; ++l)
+	{
+		const line_info &line = m_lines[l];
+		float pen = line_offset(line);
+		float y = -static_cast<float>(l) * step;
+
+		for (std::size_t i = line.begin; i < line.end; ++i)
+		{
+			const font::character *cur = m_font->at(m_data[i]);
+			if (cur->pending && i < m_first_pending)
+				m_first_pending = i;
+
+			push_glyph({pen + cur->offset.x, y + static_cast<float>(cur->offset.y - cur->region.size.y)}, cur->region);
+			pen += static_cast<float>(cur->advance >> 6);
+		}
 	}
 
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	m_vertex_first_line = first;
+	m_vertex_last_line = last;
 }
 
-void text::draw(render_target &target) const
+float text::line_advance() const
 {
-	draw(target, {});
+	return static_cast<float>(m_font->get_line_height()) * m_paragraph->line_spacing;
 }
 
-rect text::get_local_rect() const
+float text::line_offset(const line_info &line) const
 {
-	rect res{{0, 0}, {0, 0}};
+	float width = m_paragraph->max_width / m_scale.x;
+	switch (m_paragraph->align)
+	{
+	case alignment::center:
+		return (width - line.width) / 2;
+	case alignment::right:
+		return width - line.width;
+	default:
+		return 0;
+	}
+}
 
-	if (m_data.empty())
+rect text::paragraph_rect() const
+{
+	update_paragraph(true);
+	update_lines(npos, true);
+
+	rect res{{0, 0}, {0, 0}};
+	if (m_lines.empty())
 		return res;
 
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	
-	vec2 max{-m_font->at(m_data.front())->offset.x, 0};
+	float min_x = std::numeric_limits<float>::max();
+	float max_x = std::numeric_limits<float>::lowest();
+	for (const auto &line : m_lines)
+	{
+		float x = line_offset(line);
+		min_x = std::min(min_x, x);
+		max_x = std::max(max_x, x + line.width);
+	}
 
-	auto end = m_data.end() - 1;
+	float bottom = -static_cast<float>(m_lines.size() - 1) * line_advance() + static_cast<float>(m_font->get_descender());
+	res.min = {min_x, bottom};
+	res.dims = {max_x - min_x, static_cast<float>(m_font->get_ascender()) - bottom};
 
-	font::character const *cur;
+	return res;
+}
+
+void text::set_paragraph(const paragraph_layout &layout)
+{
+	if (!m_paragraph)
+		invalidate(0);
+
+	m_paragraph = layout;
+	m_lines.clear();
+	m_lines_complete = false;
+	m_first_pending = npos;
+	invalidate_vertices();
+}
+
+void text::set_single_line()
+{
+	if (!m_paragraph)
+		return;
 
-	for (auto it = m_data.begin(); it != end; ++it)
+	m_paragraph.reset();
+	m_lines.clear();
+	m_lines_complete = false;
+	m_first_pending = npos;
+	invalidate_vertices();
+}
+
+std::size_t text::get_line_count() const
+{
+	if (!m_paragraph)
+		return 1;
+
+	if (m_data.empty() || !m_font)
+		return 0;
+
+	update_paragraph(true);
+	update_lines(npos, true);
+	return m_lines.size();
+}
+
+render_shader *text::default_shader() const
+{
+	if (!m_font)
+		return nullptr;
+	return m_font->get_mode() == font::glyph_mode::sdf ? &text_detail::get_sdf_shader() : &text_detail::get_shader();
+}
+
+void text::draw(render_target &target, const render_settings &settings) const
+{
+	if (m_data.empty() || !m_font)
+		return;
+
+	// only characters added or changed since the last draw are laid out
+	if (m_paragraph)
 	{
-		cur = m_font->at(*it);
-		max.x += cur->advance >> 6;
+		update_paragraph();
+		update_paragraph_vertices();
+	}
+	else
+	{
+		update_layout();
+		update_vertices();
+	}
+
+	// pages are evicted in the order they were last drawn, so a label drawn every frame keeps its glyphs
+	touch_pages(m_vertex_count);
 
-		if (float pot = (float)cur->offset.y - cur->text.get_height(); pot < res.min.y)
-			res.min.y = pot;
-		if (cur->offset.y > max.y)
-			max.y = (float)cur->offset.y;
+	// glyphs are placed unrotated, the whole text is rotated around m_rot_origin
+	mat4 model = identity();
+	if (m_angle != 0)
+	{
+		post_translate(model, m_rot_origin);
+		post_linear(model, rot3x3(angle_axis(m_angle, m_axis)));
+		post_translate(model, -m_rot_origin);
 	}
 
-	cur = m_font->at(*end);
-	max.x += cur->offset.x + cur->text.get_width();
+	detail::blend_lock block;
+	detail::cull_face_lock clock;
+	detail::fbo_lock flock;
+	detail::shader_lock slock;
 
-	if (float pot = (float)cur->offset.y - cur->text.get_height(); pot < res.min.y)
-		res.min.y = pot;
-	if (cur->offset.y > max.y)
-		max.y = (float)cur->offset.y;
+	detail::state().set_enabled(GL_BLEND, true);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	detail::state().set_enabled(GL_CULL_FACE, false);
 
-	res.dims = max - res.min;
+	bind_target(target);
 
-	res.dims *= m_scale;
-	res.min *= m_scale;
+	render_shader &shader = *get_shader(settings);
+	for (unsigned int page = 0; page < m_vertices.size(); ++page)
+	{
+		if (m_vertices[page].empty())
+			continue;
 
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		detail::setup_shader(shader, model, settings.engine, &m_font->page(page), settings.material, {0, 0, 0, 1});
+		text_detail::glyph_stream::get_instance().draw(m_vertices[page].data(), m_vertices[page].size() / 4);
+	}
+}
 
-	return res;
+void text::draw(render_target &target) const
+{
+	draw(target, {});
 }
 
-bound text::get_local_bound() const
+rect text::get_local_rect() const
 {
-	font::character const* cur = m_font->at(m_data.front());
+	rect res{{0, 0}, {0, 0}};
 
-	// remove first character's horizontal offset
-	auto max = -cur->offset.x * m_dir;
+	if (m_data.empty() || !m_font)
+		return res;
 
-	auto end = m_data.end() - 1;
+	if (m_paragraph)
+	{
+		res = paragraph_rect();
+		res.dims *= m_scale;
+		res.min *= m_scale;
+		return res;
+	}
 
-	float min_y = 0;
-	float max_y = 0;
+	update_layout(true);
+	update_bounds();
 
-	for (auto it = m_data.begin(); it != end; ++it)
-	{
-		cur = m_font->at(*it);
-		max += (cur->advance >> 6) * m_dir;
+	vec2 max{layout_right(), m_max_y};
+	res.min.y = m_min_y;
 
-		if (float pot = (float)cur->offset.y - cur->text.get_height(); pot < min_y)
-			min_y = pot;
-		if (cur->offset.y > max_y)
-			max_y = (float)cur->offset.y;
-	}
+	res.dims = max - res.min;
 
-	cur = m_font->at(*end);
-	max += (cur->offset.x + cur->text.get_width()) * m_dir;
+	res.dims *= m_scale;
+	res.min *= m_scale;
 
-	if (float pot = (float)cur->offset.y - cur->text.get_height(); pot < min_y)
-		min_y = pot;
-	if (cur->offset.y > max.y)
-		max_y = (float)cur->offset.y;
+	return res;
+}
 
+bound text::get_local_bound() const
+{
+	if (m_data.empty() || !m_font)
+		return {};
 
 	bound res{};
-	max += m_up * max_y;
-	res.min = m_up * min_y;
-	res.dims = max - res.min;
+	if (m_paragraph)
+	{
+		rect r = paragraph_rect();
+		res.min = r.min.x * m_dir + r.min.y * m_up;
+		res.dims = r.max().x * m_dir + r.max().y * m_up - res.min;
+	}
+	else
+	{
+		update_layout(true);
+		update_bounds();
+
+		vec3 max = layout_right() * m_dir + m_up * m_max_y;
+
+		res.min = m_up * m_min_y;
+		res.dims = max - res.min;
+	}
 
 	vec3 scale = m_dir * m_scale.x + m_up * m_scale.y;
 
 	res.dims *= scale;
 	res.min *= scale;
 
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-
 	return res;
 }
 
-SGL_END
\ No newline at end of file
+SGL_END
@@ -170,6 +170,7 @@ void texture::reserve(GLenum target_format, GLsizei width, GLsizei height)
 	{
 	case GL_DEPTH_COMPONENT:
 	case GL_RED:
+	case GL_R8:
 		nr_channels = 1;
 		break;
 	case GL_RG:
@@ -195,4 +196,20 @@ void texture::reserve(GLenum target_format, GLsizei width, GLsizei height)
 	glTexImage2D(GL_TEXTURE_2D, 0, target_format, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
 	set_defaults();
 }
+
+void texture::update(GLint x, GLint y, GLsizei width, GLsizei height, GLenum pixel_format, const void *data) const
+{
+	detail::texture_lock lock;
+
+	use();
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, pixel_format, GL_UNSIGNED_BYTE, data);
+}
+
+void texture::read(GLenum pixel_format, void *data) const
+{
+	detail::texture_lock lock;
+
+	use();
+	glGetTexImage(GL_TEXTURE_2D, 0, pixel_format, GL_UNSIGNED_BYTE, data);
+}
 SGL_END
\ No newline at end of file
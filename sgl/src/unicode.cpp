@@ -0,0 +1,305 @@
+#include "utils/unicode.h"
+#include "math/simd.h"
+
+#include <algorithm>
+#include <bit>
+
+SGL_BEG
+
+namespace unicode_detail
+{
+	// make room for extra codepoints at the end of out, growing geometrically so repeated appends stay amortized
+	uint32_t *grow(std::basic_string<uint32_t> &out, std::size_t extra)
+	{
+		std::size_t size = out.size();
+		if (out.capacity() < size + extra)
+			out.reserve(std::max(size + extra, 2 * out.capacity()));
+		out.resize(size + extra);
+		return out.data() + size;
+	}
+
+#ifdef SGL_SIMD
+	// widen 16 bytes to codepoints if they are all ascii
+	inline bool ascii_block(const unsigned char *in, uint32_t *out)
+	{
+#if defined(SGL_SIMD_SSE)
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+		if (_mm_movemask_epi8(v))
+			return false;
+
+		__m128i zero = _mm_setzero_si128();
+		__m128i lo = _mm_unpacklo_epi8(v, zero);
+		__m128i hi = _mm_unpackhi_epi8(v, zero);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi16(lo, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4), _mm_unpackhi_epi16(lo, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + 8), _mm_unpacklo_epi16(hi, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + 12), _mm_unpackhi_epi16(hi, zero));
+		return true;
+#elif defined(SGL_SIMD_NEON)
+		uint8x16_t v = vld1q_u8(in);
+		uint64x2_t high_bits = vreinterpretq_u64_u8(vandq_u8(v, vdupq_n_u8(0x80)));
+		if (vgetq_lane_u64(high_bits, 0) | vgetq_lane_u64(high_bits, 1))
+			return false;
+
+		uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+		uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+		vst1q_u32(out, vmovl_u16(vget_low_u16(lo)));
+		vst1q_u32(out + 4, vmovl_u16(vget_high_u16(lo)));
+		vst1q_u32(out + 8, vmovl_u16(vget_low_u16(hi)));
+		vst1q_u32(out + 12, vmovl_u16(vget_high_u16(hi)));
+		return true;
+#endif
+	}
+
+	// classification of 16 bytes, bit j of each mask describes in[j]
+	struct block_masks
+	{
+		unsigned lead2;
+		unsigned lead3;
+		unsigned cont;
+		// leads of 4 byte sequences and bytes that are never valid
+		unsigned other;
+		// overlong 2 and 3 byte leads, and leads of surrogates, judged by the byte after them
+		unsigned bad;
+		// codepoint of the 1, 2 or 3 byte sequence that would start at each byte
+		alignas(16) uint16_t cp[16];
+	};
+
+#if defined(SGL_SIMD_SSE)
+	inline void classify(const unsigned char *in, block_masks &res)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+		// the bytes after each byte, zero past the block
+		__m128i n1 = _mm_srli_si128(v, 1);
+		__m128i n2 = _mm_srli_si128(v, 2);
+
+		auto is = [](__m128i a, int mask, int value) { return _mm_cmpeq_epi8(_mm_and_si128(a, _mm_set1_epi8(static_cast<char>(mask))), _mm_set1_epi8(static_cast<char>(value))); };
+		__m128i lead2 = is(v, 0xE0, 0xC0);
+		__m128i lead3 = is(v, 0xF0, 0xE0);
+		// continuations at or past 0xA0 follow 0xE0 in every 3 byte sequence that isn't overlong, and never follow 0xED
+		__m128i low_next = is(n1, 0x20, 0);
+		__m128i bad = _mm_or_si128(is(v, 0xFE, 0xC0), _mm_or_si128(_mm_and_si128(is(v, 0xFF, 0xE0), low_next), _mm_andnot_si128(low_next, is(v, 0xFF, 0xED))));
+
+		res.lead2 = static_cast<unsigned>(_mm_movemask_epi8(lead2));
+		res.lead3 = static_cast<unsigned>(_mm_movemask_epi8(lead3));
+		res.cont = static_cast<unsigned>(_mm_movemask_epi8(is(v, 0xC0, 0x80)));
+		res.other = static_cast<unsigned>(_mm_movemask_epi8(is(v, 0xF0, 0xF0)));
+		res.bad = static_cast<unsigned>(_mm_movemask_epi8(bad));
+
+		__m128i zero = _mm_setzero_si128();
+		auto decode = [&](__m128i b, __m128i x1, __m128i x2, __m128i m2, __m128i m3)
+		{
+			__m128i six = _mm_set1_epi16(0x3F);
+			__m128i c2 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(b, _mm_set1_epi16(0x1F)), 6), _mm_and_si128(x1, six));
+			__m128i c3 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(b, _mm_set1_epi16(0x0F)), 12),
+									  _mm_or_si128(_mm_slli_epi16(_mm_and_si128(x1, six), 6), _mm_and_si128(x2, six)));
+			__m128i r = _mm_or_si128(_mm_and_si128(m2, c2), _mm_andnot_si128(m2, b));
+			return _mm_or_si128(_mm_and_si128(m3, c3), _mm_andnot_si128(m3, r));
+		};
+		_mm_store_si128(reinterpret_cast<__m128i *>(res.cp), decode(_mm_unpacklo_epi8(v, zero), _mm_unpacklo_epi8(n1, zero), _mm_unpacklo_epi8(n2, zero),
+																	_mm_unpacklo_epi8(lead2, lead2), _mm_unpacklo_epi8(lead3, lead3)));
+		_mm_store_si128(reinterpret_cast<__m128i *>(res.cp + 8), decode(_mm_unpackhi_epi8(v, zero), _mm_unpackhi_epi8(n1, zero), _mm_unpackhi_epi8(n2, zero),
+																		_mm_unpackhi_epi8(lead2, lead2), _mm_unpackhi_epi8(lead3, lead3)));
+	}
+#elif defined(SGL_SIMD_NEON)
+	// bit j set if byte j of m is set, m holding 0 or 0xFF per byte
+	inline unsigned movemask(uint8x16_t m)
+	{
+		static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+		uint8x16_t b = vandq_u8(m, vld1q_u8(weights));
+		uint8x8_t sum = vpadd_u8(vget_low_u8(b), vget_high_u8(b));
+		sum = vpadd_u8(sum, sum);
+		sum = vpadd_u8(sum, sum);
+		return vget_lane_u8(sum, 0) | static_cast<unsigned>(vget_lane_u8(sum, 1)) << 8;
+	}
+
+	inline void classify(const unsigned char *in, block_masks &res)
+	{
+		uint8x16_t v = vld1q_u8(in);
+		uint8x16_t zero = vdupq_n_u8(0);
+		// the bytes after each byte, zero past the block
+		uint8x16_t n1 = vextq_u8(v, zero, 1);
+		uint8x16_t n2 = vextq_u8(v, zero, 2);
+
+		auto is = [](uint8x16_t a, uint8_t mask, uint8_t value) { return vceqq_u8(vandq_u8(a, vdupq_n_u8(mask)), vdupq_n_u8(value)); };
+		uint8x16_t lead2 = is(v, 0xE0, 0xC0);
+		uint8x16_t lead3 = is(v, 0xF0, 0xE0);
+		// continuations at or past 0xA0 follow 0xE0 in every 3 byte sequence that isn't overlong, and never follow 0xED
+		uint8x16_t low_next = is(n1, 0x20, 0);
+		uint8x16_t bad = vorrq_u8(is(v, 0xFE, 0xC0), vorrq_u8(vandq_u8(is(v, 0xFF, 0xE0), low_next), vbicq_u8(is(v, 0xFF, 0xED), low_next)));
+
+		res.lead2 = movemask(lead2);
+		res.lead3 = movemask(lead3);
+		res.cont = movemask(is(v, 0xC0, 0x80));
+		res.other = movemask(is(v, 0xF0, 0xF0));
+		res.bad = movemask(bad);
+
+		// masks widened to 16 bits by sign extension
+		auto widen = [](uint8x8_t m) { return vreinterpretq_u16_s16(vmovl_s8(vreinterpret_s8_u8(m))); };
+		auto decode = [&](uint8x8_t b8, uint8x8_t x18, uint8x8_t x28, uint8x8_t m2, uint8x8_t m3)
+		{
+			uint16x8_t b = vmovl_u8(b8), x1 = vmovl_u8(x18), x2 = vmovl_u8(x28);
+			uint16x8_t six = vdupq_n_u16(0x3F);
+			uint16x8_t c2 = vorrq_u16(vshlq_n_u16(vandq_u16(b, vdupq_n_u16(0x1F)), 6), vandq_u16(x1, six));
+			uint16x8_t c3 = vorrq_u16(vshlq_n_u16(vandq_u16(b, vdupq_n_u16(0x0F)), 12), vorrq_u16(vshlq_n_u16(vandq_u16(x1, six), 6), vandq_u16(x2, six)));
+			return vbslq_u16(widen(m3), c3, vbslq_u16(widen(m2), c2, b));
+		};
+		vst1q_u16(res.cp, decode(vget_low_u8(v), vget_low_u8(n1), vget_low_u8(n2), vget_low_u8(lead2), vget_low_u8(lead3)));
+		vst1q_u16(res.cp + 8, decode(vget_high_u8(v), vget_high_u8(n1), vget_high_u8(n2), vget_high_u8(lead2), vget_high_u8(lead3)));
+	}
+#endif
+
+	// decode the 1, 2 and 3 byte sequences starting in 16 bytes at in, appending the codepoints to out.
+	// Returns the number of bytes decoded, from 14 to 16 (a sequence cut off by the end of the block is left for the next one),
+	// or 0 if the block holds anything else, which is then left to decode_utf8
+	inline std::size_t multibyte_block(const unsigned char *in, uint32_t *&out)
+	{
+		block_masks m;
+		classify(in, m);
+
+		unsigned size = 16;
+		if (m.lead3 & 0x4000)
+			size = 14;
+		else if ((m.lead2 | m.lead3) & 0x8000)
+			size = 15;
+		unsigned used = (1u << size) - 1;
+
+		// every continuation must belong to the lead before it and every lead must have its continuations,
+		// which also rejects a block starting with a continuation
+		unsigned expected = (m.lead2 << 1 | m.lead3 << 1 | m.lead3 << 2) & 0xFFFF;
+		if (((m.other | m.bad) & used) || expected != m.cont)
+			return 0;
+
+		for (unsigned starts = ~m.cont & used; starts; starts &= starts - 1)
+			*out++ = m.cp[std::countr_zero(starts)];
+		return size;
+	}
+#endif
+
+	// decode the sequence starting at in[i], advancing i past it
+	inline uint32_t decode_utf8(const unsigned char *in, std::size_t size, std::size_t &i)
+	{
+		unsigned char lead = in[i];
+		if (lead < 0x80)
+		{
+			++i;
+			return lead;
+		}
+
+		int length;
+		uint32_t res;
+		uint32_t min;
+		if ((lead & 0xE0) == 0xC0)
+		{
+			length = 2;
+			res = lead & 0x1F;
+			min = 0x80;
+		}
+		else if ((lead & 0xF0) == 0xE0)
+		{
+			length = 3;
+			res = lead & 0x0F;
+			min = 0x800;
+		}
+		else if ((lead & 0xF8) == 0xF0)
+		{
+			length = 4;
+			res = lead & 0x07;
+			min = 0x10000;
+		}
+		else // stray continuation byte or invalid lead
+		{
+			++i;
+			return replacement_character;
+		}
+
+		int read = 1;
+		for (; read < length && i + read < size && (in[i + read] & 0xC0) == 0x80; ++read)
+			res = res << 6 | (in[i + read] & 0x3F);
+
+		// a truncated sequence is replaced as a whole, the byte that cut it short starts the next one
+		i += read;
+		if (read < length || res < min || res > 0x10FFFF || (res >= 0xD800 && res <= 0xDFFF))
+			return replacement_character;
+		return res;
+	}
+}
+
+void append_utf8(std::basic_string<uint32_t> &out, std::string_view in)
+{
+	using namespace unicode_detail;
+
+	const unsigned char *data = reinterpret_cast<const unsigned char *>(in.data());
+	std::size_t size = in.size();
+
+	// every byte decodes to at most one codepoint
+	std::size_t start = out.size();
+	uint32_t *dst = grow(out, size);
+
+	std::size_t i = 0;
+	while (i < size)
+	{
+#ifdef SGL_SIMD
+		if (size - i >= 16)
+		{
+			if (ascii_block(data + i, dst))
+			{
+				i += 16;
+				dst += 16;
+				continue;
+			}
+			if (std::size_t read = multibyte_block(data + i, dst))
+			{
+				i += read;
+				continue;
+			}
+		}
+
+		// 4 byte or invalid sequences, and the tail, a block at a time so the vector paths can pick up after them
+		std::size_t end = std::min(size, i + 16);
+#else
+		std::size_t end = size;
+#endif
+		while (i < end)
+			*dst++ = decode_utf8(data, size, i);
+	}
+
+	// shrinking never reallocates
+	out.resize(start + static_cast<std::size_t>(dst - (out.data() + start)));
+}
+
+void append_utf16(std::basic_string<uint32_t> &out, std::u16string_view in)
+{
+	std::size_t start = out.size();
+	uint32_t *dst = unicode_detail::grow(out, in.size());
+
+	for (std::size_t i = 0; i < in.size(); ++i)
+	{
+		uint32_t c = in[i];
+		if (c < 0xD800 || c > 0xDFFF)
+			*dst++ = c;
+		else if (c <= 0xDBFF && i + 1 < in.size() && in[i + 1] >= 0xDC00 && in[i + 1] <= 0xDFFF)
+		{
+			*dst++ = 0x10000 + ((c - 0xD800) << 10) + (in[i + 1] - 0xDC00);
+			++i;
+		}
+		else
+			*dst++ = replacement_character;
+	}
+
+	out.resize(start + static_cast<std::size_t>(dst - (out.data() + start)));
+}
+
+void append_wide(std::basic_string<uint32_t> &out, std::wstring_view in)
+{
+	if constexpr (sizeof(wchar_t) == sizeof(char16_t))
+		append_utf16(out, {reinterpret_cast<const char16_t *>(in.data()), in.size()});
+	else
+	{
+		uint32_t *dst = unicode_detail::grow(out, in.size());
+		for (wchar_t c : in)
+			*dst++ = static_cast<uint32_t>(c) <= 0x10FFFF ? static_cast<uint32_t>(c) : replacement_character;
+	}
+}
+
+SGL_END
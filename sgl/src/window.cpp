@@ -90,6 +90,9 @@ window::window(int width, int height, const std::string &name, window::creation_
 		glfwMakeContextCurrent(m_window);
 		if (glewInit() != GLEW_OK)
 			detail::log_error(error("Couldn't load glew.", error_code::glew_initialization_failure));
+
+		// new context, nothing cached applies to it
+		detail::state().invalidate();
 	}
 	else
 		detail::log_error(error("Couldn't create window.", error_code::window_creation_failure));
@@ -377,7 +380,7 @@ void window::remove_scroll_callback() { glfwSetScrollCallback(m_window, nullptr)
 
 void window::bind_framebuffer()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	detail::state().bind_framebuffer(0);
 }
 
 SGL_END
\ No newline at end of file